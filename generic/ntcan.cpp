@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <time.h>
 #include <cstdint>
 
 #include "../config.h"
@@ -20,7 +22,7 @@
 extern "C" {
     // extern for C++.
     int Ntcan_Init(Tcl_Interp *interp);
-    int Ntcan_Unload(Tcl_Interp *interp);
+    int Ntcan_Unload(Tcl_Interp *interp, int flags);
 }
 
 void FormatError(Tcl_Interp *interp, char* cmd, NTCAN_RESULT error) {
@@ -32,6 +34,523 @@ void FormatError(Tcl_Interp *interp, char* cmd, NTCAN_RESULT error) {
     Tcl_AppendResult(interp, &statusTxt, NULL);
 }
 
+/*
+ * Per-handle state of the native worker features. Entries are created on
+ * demand, keyed by the driver handle, and released by Close before the
+ * handle itself is closed.
+ */
+
+struct Monitor;
+struct IsoTpChannel;
+struct Exchange;
+struct Filter;
+struct TxQueue;
+struct Gateway;
+
+typedef struct HandleInfo {
+    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
+    struct Monitor *monitor;                  /* Health monitor or NULL */
+    struct IsoTpChannel *isotp;               /* ISO-TP channel or NULL */
+    struct Exchange *exchanges;               /* Pending asynchronous requests */
+    struct Filter *filter;                    /* Software acceptance filter or NULL */
+    struct TxQueue *txqueue;                  /* Asynchronous transmit queue or NULL */
+    struct Gateway *gateway;                  /* Gateway reading this handle or NULL */
+#ifdef NTCAN_PERF
+    struct PerfStats *perf;                   /* Instrumentation probes */
+#endif
+} HandleInfo;
+
+static Tcl_HashTable handleTable;
+static int handleTableInit = 0;
+TCL_DECLARE_MUTEX(handleMutex)
+
+static void StopMonitor(struct Monitor *mon);
+static void StopIsoTp(struct IsoTpChannel *ch);
+static void CancelExchanges(HandleInfo *info);
+static void FreeFilter(struct Filter *filter);
+static void StopTxQueue(struct TxQueue *q);
+static void StopGateway(struct Gateway *gw);
+static void StopGatewaysTo(TCL_NTCAN_HANDLE dst);
+static struct Gateway *DetachGateway(HandleInfo *info);
+#ifdef NTCAN_PERF
+static struct PerfStats *NewPerfStats(void);
+static void FreePerfStats(struct PerfStats *stats);
+#endif
+
+static HandleInfo *GetHandleInfo(TCL_NTCAN_HANDLE handle, int create) {
+    Tcl_HashEntry *entry;
+    HandleInfo *info = NULL;
+    int isNew;
+
+    Tcl_MutexLock(&handleMutex);
+    if (create) {
+        entry = Tcl_CreateHashEntry(&handleTable, (char *)(intptr_t)handle, &isNew);
+        if (isNew) {
+            info = (HandleInfo *)ckalloc(sizeof(HandleInfo));
+            memset(info, 0, sizeof(HandleInfo));
+            info->handle = handle;
+#ifdef NTCAN_PERF
+            info->perf = NewPerfStats();
+#endif
+            Tcl_SetHashValue(entry, info);
+        } else {
+            info = (HandleInfo *)Tcl_GetHashValue(entry);
+        }
+    } else {
+        entry = Tcl_FindHashEntry(&handleTable, (char *)(intptr_t)handle);
+        if (entry != NULL) {
+            info = (HandleInfo *)Tcl_GetHashValue(entry);
+        }
+    }
+    Tcl_MutexUnlock(&handleMutex);
+    return info;
+}
+
+static void ReleaseHandleInfo(TCL_NTCAN_HANDLE handle) {
+    HandleInfo *info;
+    struct Gateway *gw;
+
+    /* Gateways of other handles may send to this one */
+    StopGatewaysTo(handle);
+
+    info = GetHandleInfo(handle, 0);
+    if (info == NULL) {
+        return;
+    }
+    if (info->monitor != NULL) {
+        StopMonitor(info->monitor);
+        info->monitor = NULL;
+    }
+    if (info->isotp != NULL) {
+        StopIsoTp(info->isotp);
+        info->isotp = NULL;
+    }
+    gw = DetachGateway(info);
+    if (gw != NULL) {
+        StopGateway(gw);
+    }
+    if (info->txqueue != NULL) {
+        StopTxQueue(info->txqueue);
+        info->txqueue = NULL;
+    }
+    CancelExchanges(info);
+    if (info->filter != NULL) {
+        FreeFilter(info->filter);
+    }
+
+    Tcl_MutexLock(&handleMutex);
+    Tcl_DeleteHashEntry(Tcl_FindHashEntry(&handleTable, (char *)(intptr_t)handle));
+    Tcl_MutexUnlock(&handleMutex);
+#ifdef NTCAN_PERF
+    FreePerfStats(info->perf);
+#endif
+    ckfree((char *)info);
+}
+
+static Tcl_WideInt GetTimeUs(void) {
+    Tcl_Time now;
+
+    Tcl_GetTime(&now);
+    return (Tcl_WideInt)now.sec * 1000000 + now.usec;
+}
+
+/*
+ * Log-linear latency histogram: exact below 8 units, then 8 sub-buckets per
+ * power of two (relative error below 12.5 %), up to 2^34 units.
+ */
+
+#define LATENCY_BUCKETS 256
+
+typedef struct LatencyHistogram {
+    Tcl_WideInt counts[LATENCY_BUCKETS];
+    Tcl_WideInt total;                        /* Values recorded */
+    Tcl_WideInt max;                          /* Largest value recorded */
+} LatencyHistogram;
+
+static void LatencyRecord(LatencyHistogram *hist, Tcl_WideInt value) {
+    int e = 3;
+    int bucket;
+
+    if (value < 0) {
+        value = 0;
+    }
+    if (value < 8) {
+        bucket = (int)value;
+    } else {
+        while (e < 33 && (value >> (e + 1)) != 0) {
+            e++;
+        }
+        bucket = (value >> (e + 1)) != 0 ? LATENCY_BUCKETS - 1 : (e - 2) * 8 + (int)((value >> (e - 3)) & 7);
+    }
+    hist->counts[bucket]++;
+    hist->total++;
+    if (value > hist->max) {
+        hist->max = value;
+    }
+}
+
+/* Largest value counted in a bucket */
+static Tcl_WideInt LatencyBucketUpper(int bucket) {
+    if (bucket < 8) {
+        return bucket;
+    }
+    return ((Tcl_WideInt)(8 + bucket % 8 + 1) << (bucket / 8 - 1)) - 1;
+}
+
+/* Upper bound of the bucket holding the given per-mille rank, capped at max */
+static Tcl_WideInt LatencyPercentile(LatencyHistogram *hist, int permille) {
+    Tcl_WideInt rank, seen = 0, upper;
+    int bucket;
+
+    if (hist->total == 0) {
+        return 0;
+    }
+    rank = (hist->total * permille + 999) / 1000;
+    if (rank < 1) {
+        rank = 1;
+    }
+    for (bucket = 0; bucket < LATENCY_BUCKETS - 1; bucket++) {
+        seen += hist->counts[bucket];
+        if (seen >= rank) {
+            break;
+        }
+    }
+    upper = LatencyBucketUpper(bucket);
+    return upper < hist->max ? upper : hist->max;
+}
+
+/* List of p50, p90, p99, p99.9 and max */
+static Tcl_Obj *LatencyObj(LatencyHistogram *hist) {
+    static const int permilles[] = { 500, 900, 990, 999 };
+    Tcl_Obj *objLatency = Tcl_NewListObj(0, NULL);
+
+    for (int i = 0; i < 4; i++) {
+        Tcl_ListObjAppendElement(NULL, objLatency, Tcl_NewWideIntObj(LatencyPercentile(hist, permilles[i])));
+    }
+    Tcl_ListObjAppendElement(NULL, objLatency, Tcl_NewWideIntObj(hist->max));
+    return objLatency;
+}
+
+/*
+ * Hot-path instrumentation, compiled in with --enable-perf. Every driver
+ * read, write and ioctl and the conversion of frames to and from Tcl objects
+ * is timed with a monotonic clock into per-handle probes. Without the flag
+ * the PERF_* macros expand to nothing and the driver is called directly.
+ */
+
+#ifdef NTCAN_PERF
+
+enum {
+    PERF_CAN_READ, PERF_CAN_READX, PERF_CAN_TAKEX, PERF_CAN_WRITE, PERF_CAN_WRITEX,
+    PERF_CAN_SENDX, PERF_CAN_IOCTL, PERF_MARSHAL, PERF_CALLS
+};
+
+static const char *perfCallNames[PERF_CALLS] = {
+    "canRead", "canReadX", "canTakeX", "canWrite", "canWriteX",
+    "canSendX", "canIoctl", "marshal"
+};
+
+/*
+ * Probes are keyed by the context issuing the call: the Tcl command running
+ * in the calling thread, or the kind of worker thread. Context 0 collects
+ * calls made outside of both, e.g. from the exit handler.
+ */
+
+#define PERF_CONTEXTS 64
+
+static const char *perfContextNames[PERF_CONTEXTS] = { "other" };
+static int perfContextCount = 1;
+TCL_DECLARE_MUTEX(perfContextMutex)
+
+typedef struct PerfProbe {
+    Tcl_WideInt calls;
+    Tcl_WideInt errors;                       /* Failed driver calls, timeouts and aborts excluded */
+    Tcl_WideInt total;                        /* Sum of all durations in ns */
+    LatencyHistogram hist;                    /* Durations in ns */
+} PerfProbe;
+
+typedef struct PerfStats {
+    Tcl_Mutex mutex;                          /* Guards the probes */
+    PerfProbe *probes[PERF_CONTEXTS];         /* PERF_CALLS probes per context or NULL */
+} PerfStats;
+
+/*
+ * Worker threads remember the entry of the handle they serve. It cannot be
+ * freed before the worker is joined, so their probes are updated without a
+ * table lookup.
+ */
+
+typedef struct PerfThreadData {
+    int context;                              /* Context of the calls made now */
+    HandleInfo *info;                         /* Entry of the served handle or NULL */
+} PerfThreadData;
+
+static Tcl_ThreadDataKey perfDataKey;
+
+/* Wrapped command and its context */
+typedef struct PerfCommandInfo {
+    Tcl_ObjCmdProc *proc;
+    ClientData clientData;
+    int context;
+} PerfCommandInfo;
+
+static PerfStats *NewPerfStats(void) {
+    PerfStats *stats = (PerfStats *)ckalloc(sizeof(PerfStats));
+
+    memset(stats, 0, sizeof(PerfStats));
+    return stats;
+}
+
+/* The entry is already out of the table; wait for a PerfRecord() still holding the mutex */
+static void FreePerfStats(PerfStats *stats) {
+    Tcl_MutexLock(&stats->mutex);
+    Tcl_MutexUnlock(&stats->mutex);
+    Tcl_MutexFinalize(&stats->mutex);
+    for (int i = 0; i < PERF_CONTEXTS; i++) {
+        if (stats->probes[i] != NULL) {
+            ckfree((char *)stats->probes[i]);
+        }
+    }
+    ckfree((char *)stats);
+}
+
+/* Index of a context name, added on first use; names beyond the table share "other" */
+static int PerfContext(const char *name) {
+    int i;
+
+    Tcl_MutexLock(&perfContextMutex);
+    for (i = 0; i < perfContextCount && strcmp(perfContextNames[i], name) != 0; i++) {
+    }
+    if (i == perfContextCount) {
+        if (i < PERF_CONTEXTS) {
+            char *copy = (char *)ckalloc(strlen(name) + 1);
+
+            strcpy(copy, name);
+            perfContextNames[i] = copy;
+            perfContextCount++;
+        } else {
+            i = 0;
+        }
+    }
+    Tcl_MutexUnlock(&perfContextMutex);
+    return i;
+}
+
+/* Monotonic time in ns */
+static Tcl_WideInt PerfNow(void) {
+#if defined(_WIN32)
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&now);
+    return (Tcl_WideInt)(now.QuadPart / freq.QuadPart * 1000000000 +
+                         now.QuadPart % freq.QuadPart * 1000000000 / freq.QuadPart);
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (Tcl_WideInt)now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+/*
+ * The thread data of a worker is freed by Tcl_FinalizeThread() when it
+ * exits (PERF_WORKER_DONE), or every request would leave a block behind.
+ */
+static void PerfWorker(const char *name, TCL_NTCAN_HANDLE handle) {
+    PerfThreadData *tsd = (PerfThreadData *)Tcl_GetThreadData(&perfDataKey, sizeof(PerfThreadData));
+
+    tsd->context = PerfContext(name);
+    tsd->info = GetHandleInfo(handle, 0);
+}
+
+/*
+ * Calls on handles not opened by Open are not recorded. The probes are locked
+ * before the table is released, so Close cannot free them underneath.
+ */
+static void PerfRecord(TCL_NTCAN_HANDLE handle, int call, Tcl_WideInt ns, NTCAN_RESULT result) {
+    PerfThreadData *tsd = (PerfThreadData *)Tcl_GetThreadData(&perfDataKey, sizeof(PerfThreadData));
+    Tcl_HashEntry *entry;
+    PerfStats *stats;
+    PerfProbe *p;
+
+    if (tsd->info != NULL && tsd->info->handle == handle) {
+        stats = tsd->info->perf;
+        Tcl_MutexLock(&stats->mutex);
+    } else {
+        Tcl_MutexLock(&handleMutex);
+        entry = Tcl_FindHashEntry(&handleTable, (char *)(intptr_t)handle);
+        if (entry == NULL) {
+            Tcl_MutexUnlock(&handleMutex);
+            return;
+        }
+        stats = ((HandleInfo *)Tcl_GetHashValue(entry))->perf;
+        Tcl_MutexLock(&stats->mutex);
+        Tcl_MutexUnlock(&handleMutex);
+    }
+    if (stats->probes[tsd->context] == NULL) {
+        stats->probes[tsd->context] = (PerfProbe *)ckalloc(PERF_CALLS * sizeof(PerfProbe));
+        memset(stats->probes[tsd->context], 0, PERF_CALLS * sizeof(PerfProbe));
+    }
+    p = &stats->probes[tsd->context][call];
+    p->calls++;
+    p->errors += result != NTCAN_SUCCESS && result != NTCAN_RX_TIMEOUT && result != NTCAN_OPERATION_ABORTED;
+    p->total += ns;
+    LatencyRecord(&p->hist, ns);
+    Tcl_MutexUnlock(&stats->mutex);
+}
+
+/* Runs a wrapped command with its context set for the calling thread */
+static int PerfCommand(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    PerfCommandInfo *cmd = (PerfCommandInfo *)cData;
+    PerfThreadData *tsd = (PerfThreadData *)Tcl_GetThreadData(&perfDataKey, sizeof(PerfThreadData));
+    int saved = tsd->context;
+    int code;
+
+    tsd->context = cmd->context;
+    code = cmd->proc(cmd->clientData, interp, objc, objv);
+    tsd->context = saved;
+    return code;
+}
+
+static void PerfCommandDelete(ClientData cData) {
+    ckfree((char *)cData);
+}
+
+/* Wraps every command of the namespace so driver calls are keyed by command name */
+static int PerfWrapCommands(Tcl_Interp *interp) {
+    Tcl_Obj *objNames;
+    Tcl_Obj **names;
+    int count;
+
+    if (Tcl_EvalEx(interp, "info commands ::" NS_PREFIX "*", -1, TCL_EVAL_GLOBAL) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    objNames = Tcl_GetObjResult(interp);
+    Tcl_IncrRefCount(objNames);
+    Tcl_ResetResult(interp);
+    Tcl_ListObjGetElements(NULL, objNames, &count, &names);
+    for (int i = 0; i < count; i++) {
+        const char *name = Tcl_GetString(names[i]);
+        Tcl_CmdInfo info;
+        PerfCommandInfo *cmd;
+
+        if (!Tcl_GetCommandInfo(interp, name, &info) || info.objProc == PerfCommand) {
+            continue;
+        }
+        cmd = (PerfCommandInfo *)ckalloc(sizeof(PerfCommandInfo));
+        cmd->proc = info.objProc;
+        cmd->clientData = info.objClientData;
+        cmd->context = PerfContext(name + strlen("::" NS_PREFIX));
+        info.objProc = PerfCommand;
+        info.objClientData = cmd;
+        info.deleteProc = PerfCommandDelete;
+        info.deleteData = cmd;
+        Tcl_SetCommandInfo(interp, name, &info);
+    }
+    Tcl_DecrRefCount(objNames);
+    return TCL_OK;
+}
+
+#define PERF_WORKER(name, handle)      PerfWorker((name), (TCL_NTCAN_HANDLE)(handle))
+#define PERF_WORKER_DONE()             Tcl_FinalizeThread()
+#define PERF_START(var)                Tcl_WideInt var = PerfNow()
+#define PERF_STOP(handle, var)         PerfRecord((TCL_NTCAN_HANDLE)(handle), PERF_MARSHAL, PerfNow() - (var), NTCAN_SUCCESS)
+
+/*
+ * Timed driver entry points. The defines below route every call in this
+ * file through them, including the calls made by worker threads.
+ */
+
+#define PERF_DRIVER_CALL(handle, probe, call)                                  \
+    Tcl_WideInt start = PerfNow();                                              \
+    NTCAN_RESULT result = (call);                                               \
+    PerfRecord((TCL_NTCAN_HANDLE)(handle), (probe), PerfNow() - start, result); \
+    return result
+
+static NTCAN_RESULT PerfCanRead(NTCAN_HANDLE handle, CMSG *cmsg, int32_t *len, OVERLAPPED *ovrlppd) {
+    PERF_DRIVER_CALL(handle, PERF_CAN_READ, canRead(handle, cmsg, len, ovrlppd));
+}
+
+static NTCAN_RESULT PerfCanReadX(NTCAN_HANDLE handle, CMSG_X *cmsg, int32_t *len, OVERLAPPED *ovrlppd) {
+    PERF_DRIVER_CALL(handle, PERF_CAN_READX, canReadX(handle, cmsg, len, ovrlppd));
+}
+
+static NTCAN_RESULT PerfCanTakeX(NTCAN_HANDLE handle, CMSG_X *cmsg, int32_t *len) {
+    PERF_DRIVER_CALL(handle, PERF_CAN_TAKEX, canTakeX(handle, cmsg, len));
+}
+
+static NTCAN_RESULT PerfCanWrite(NTCAN_HANDLE handle, CMSG *cmsg, int32_t *len, OVERLAPPED *ovrlppd) {
+    PERF_DRIVER_CALL(handle, PERF_CAN_WRITE, canWrite(handle, cmsg, len, ovrlppd));
+}
+
+static NTCAN_RESULT PerfCanWriteX(NTCAN_HANDLE handle, CMSG_X *cmsg, int32_t *len, OVERLAPPED *ovrlppd) {
+    PERF_DRIVER_CALL(handle, PERF_CAN_WRITEX, canWriteX(handle, cmsg, len, ovrlppd));
+}
+
+static NTCAN_RESULT PerfCanSendX(NTCAN_HANDLE handle, CMSG_X *cmsg, int32_t *len) {
+    PERF_DRIVER_CALL(handle, PERF_CAN_SENDX, canSendX(handle, cmsg, len));
+}
+
+static NTCAN_RESULT PerfCanIoctl(NTCAN_HANDLE handle, uint32_t cmd, void *arg) {
+    PERF_DRIVER_CALL(handle, PERF_CAN_IOCTL, canIoctl(handle, cmd, arg));
+}
+
+#define canRead   PerfCanRead
+#define canReadX  PerfCanReadX
+#define canTakeX  PerfCanTakeX
+#define canWrite  PerfCanWrite
+#define canWriteX PerfCanWriteX
+#define canSendX  PerfCanSendX
+#define canIoctl  PerfCanIoctl
+
+#else
+
+#define PERF_WORKER(name, handle)
+#define PERF_WORKER_DONE()
+#define PERF_START(var)
+#define PERF_STOP(handle, var)
+
+#endif
+
+static void HandleExitHandler(ClientData cData) {
+    Tcl_HashEntry *entry;
+    Tcl_HashSearch search;
+
+    /* Worker threads must not outlive the process teardown */
+    while (handleTableInit && (entry = Tcl_FirstHashEntry(&handleTable, &search)) != NULL) {
+        ReleaseHandleInfo(((HandleInfo *)Tcl_GetHashValue(entry))->handle);
+    }
+}
+
+/*
+ * Evaluates a callback script with the given arguments appended. Worker
+ * threads never touch Tcl objects; they queue events to the owning thread,
+ * whose event handler ends up here.
+ */
+static void InvokeCallback(Tcl_Interp *interp, Tcl_Obj *command, int objc, Tcl_Obj *const objv[]) {
+    Tcl_Obj *script;
+    int code;
+
+    script = Tcl_DuplicateObj(command);
+    Tcl_IncrRefCount(script);
+    if (Tcl_ListObjReplace(interp, script, INT_MAX, 0, objc, objv) != TCL_OK) {
+        Tcl_DecrRefCount(script);
+        Tcl_BackgroundException(interp, TCL_ERROR);
+        return;
+    }
+    Tcl_Preserve(interp);
+    code = Tcl_EvalObjEx(interp, script, TCL_EVAL_GLOBAL);
+    if (code != TCL_OK) {
+        Tcl_BackgroundException(interp, code);
+    }
+    Tcl_Release(interp);
+    Tcl_DecrRefCount(script);
+}
+
 int Scan(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
     int i;
     NTCAN_HANDLE handle;                      /* CAN handle returned by canOpen() */
@@ -104,6 +623,9 @@ int Open(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
         FormatError(interp, "canOpen", retvalue);
         return TCL_ERROR;
     } else {
+#ifdef NTCAN_PERF
+        GetHandleInfo((TCL_NTCAN_HANDLE)handle, 1);
+#endif
         Tcl_SetObjResult(interp, Tcl_NewWideIntObj((TCL_NTCAN_HANDLE)handle));
         return TCL_OK;
     }
@@ -119,6 +641,7 @@ int Close(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
     }
     Tcl_GetWideIntFromObj(interp, objv[1], &handle);
 
+    ReleaseHandleInfo(handle);
     retvalue = canClose((NTCAN_HANDLE)handle);
 
     if (retvalue != NTCAN_SUCCESS) {
@@ -352,6 +875,293 @@ int IdRegionDelete(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *cons
     }
 }
 
+/*
+ * Software acceptance filter: first-match rules on ID, flags, DLC and masked
+ * payload bytes, applied by Read/ReadX before a frame becomes a Tcl object.
+ * Rules are compiled into a flat table; payload masks are compared as 64-bit
+ * words from a shared pool.
+ */
+
+#define FILTER_MAX_RULES 1024
+
+typedef struct FilterRule {
+    int32_t id;                               /* Expected ID ... */
+    int32_t idMask;                           /* ... compared under this mask */
+    uint8_t flags;                            /* Expected NTCAN_FD/NTCAN_RTR bits ... */
+    uint8_t flagsMask;                        /* ... compared under this mask */
+    int8_t dlc;                               /* Expected DLC or -1 for any */
+    uint8_t accept;                           /* 1 = accept, 0 = reject */
+    uint8_t minSize;                          /* Frame must carry the masked bytes */
+    uint8_t words;                            /* Payload words compared */
+    uint16_t wordOffset;                      /* First value/mask word pair in the pool */
+} FilterRule;
+
+typedef struct Filter {
+    int count;                                /* Number of rules */
+    int defaultAccept;                        /* Action if no rule matches */
+    FilterRule *rules;
+    uint64_t *words;                          /* Value/mask pairs of payload compares */
+    Tcl_WideInt *hits;                        /* Hits per rule */
+    Tcl_WideInt defaultHits;                  /* Frames no rule matched */
+} Filter;
+
+static void FreeFilter(Filter *filter) {
+    ckfree((char *)filter->rules);
+    ckfree((char *)filter->words);
+    ckfree((char *)filter->hits);
+    ckfree((char *)filter);
+}
+
+static int FilterAccept(Filter *filter, int32_t id, uint8_t len, const uint8_t *data) {
+    int size = NTCAN_LEN_TO_DATASIZE(len);
+    uint64_t frame[8];
+    int loaded = 0;
+
+    for (int i = 0; i < filter->count; i++) {
+        FilterRule *rule = &filter->rules[i];
+
+        if (((id ^ rule->id) & rule->idMask) ||
+            ((len ^ rule->flags) & rule->flagsMask) ||
+            (rule->dlc >= 0 && (len & 0x0F) != rule->dlc) ||
+            size < rule->minSize) {
+            continue;
+        }
+        if (rule->words > 0) {
+            const uint64_t *word = filter->words + 2 * rule->wordOffset;
+            int w;
+
+            if (!loaded) {
+                memset(frame, 0, sizeof(frame));
+                memcpy(frame, data, size);
+                loaded = 1;
+            }
+            for (w = 0; w < rule->words; w++, word += 2) {
+                if ((frame[w] ^ word[0]) & word[1]) {
+                    break;
+                }
+            }
+            if (w < rule->words) {
+                continue;
+            }
+        }
+        filter->hits[i]++;
+        return rule->accept;
+    }
+    filter->defaultHits++;
+    return filter->defaultAccept;
+}
+
+/* Bounds a filtered read by the Rx timeout of the handle */
+static int FilterExpired(NTCAN_HANDLE handle, Tcl_WideInt *deadline) {
+    uint32_t timeout;
+
+    if (*deadline == 0) {
+        if (canIoctl(handle, NTCAN_IOCTL_GET_RX_TIMEOUT, &timeout) != NTCAN_SUCCESS || timeout == 0) {
+            *deadline = -1;
+        } else {
+            *deadline = GetTimeUs() + (Tcl_WideInt)timeout * 1000;
+        }
+    }
+    return *deadline > 0 && GetTimeUs() >= *deadline;
+}
+
+static int FilterCompileRule(Tcl_Interp *interp, Tcl_Obj *objRule, FilterRule *rule,
+                             uint64_t *words, int *wordCount) {
+    static const char *actions[] = { "reject", "accept", NULL };
+    static const char *options[] = { "id", "idmask", "data", "datamask", "dlc", "fd", "rtr", NULL };
+    enum { OPT_ID, OPT_IDMASK, OPT_DATA, OPT_DATAMASK, OPT_DLC, OPT_FD, OPT_RTR };
+    Tcl_Obj **elem;
+    int elemc, action, option, value;
+    int haveId = 0, haveIdMask = 0;
+    unsigned char *data = NULL, *mask = NULL;
+    int dataLen = 0, maskLen = -1;
+
+    if (Tcl_ListObjGetElements(interp, objRule, &elemc, &elem) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (elemc < 1 || !(elemc & 1)) {
+        Tcl_AppendResult(interp, "NTCAN filter rule must be \"accept|reject ?option value ...?\"", NULL);
+        return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, elem[0], actions, "action", 0, &action) != TCL_OK) {
+        return TCL_ERROR;
+    }
+
+    memset(rule, 0, sizeof(FilterRule));
+    rule->accept = action;
+    rule->dlc = -1;
+    for (int i = 1; i < elemc; i += 2) {
+        if (Tcl_GetIndexFromObj(interp, elem[i], options, "option", 0, &option) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        if (option == OPT_DATA) {
+            data = Tcl_GetByteArrayFromObj(elem[i + 1], &dataLen);
+            continue;
+        } else if (option == OPT_DATAMASK) {
+            mask = Tcl_GetByteArrayFromObj(elem[i + 1], &maskLen);
+            continue;
+        }
+        if (Tcl_GetIntFromObj(interp, elem[i + 1], &value) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        switch (option) {
+        case OPT_ID:
+            rule->id = value;
+            haveId = 1;
+            break;
+        case OPT_IDMASK:
+            rule->idMask = value;
+            haveIdMask = 1;
+            break;
+        case OPT_DLC:
+            if (value < 0 || value > 15) {
+                Tcl_AppendResult(interp, "NTCAN filter dlc out of range", NULL);
+                return TCL_ERROR;
+            }
+            rule->dlc = value;
+            break;
+        case OPT_FD:
+            rule->flagsMask |= NTCAN_FD;
+            rule->flags |= value ? NTCAN_FD : 0;
+            break;
+        case OPT_RTR:
+            rule->flagsMask |= NTCAN_RTR;
+            rule->flags |= value ? NTCAN_RTR : 0;
+            break;
+        }
+    }
+    if (!haveIdMask) {
+        /* An ID alone selects exactly that ID, no ID selects any */
+        rule->idMask = haveId ? -1 : 0;
+    }
+    rule->id &= rule->idMask;
+
+    /* Without datamask all given data bytes are compared */
+    if (maskLen < 0) {
+        maskLen = dataLen;
+    }
+    if (dataLen > 64 || maskLen > 64) {
+        Tcl_AppendResult(interp, "NTCAN filter data longer than 64 bytes", NULL);
+        return TCL_ERROR;
+    }
+    uint8_t value8[64], mask8[64];
+    memset(value8, 0, sizeof(value8));
+    memset(mask8, 0, sizeof(mask8));
+    memcpy(value8, data, dataLen);
+    if (mask != NULL) {
+        memcpy(mask8, mask, maskLen);
+    } else {
+        memset(mask8, 0xFF, maskLen);
+    }
+    for (int i = 0; i < maskLen; i++) {
+        value8[i] &= mask8[i];
+        if (mask8[i] != 0) {
+            rule->minSize = i + 1;
+        }
+    }
+    rule->words = (rule->minSize + 7) / 8;
+    rule->wordOffset = *wordCount;
+    for (int w = 0; w < rule->words; w++) {
+        memcpy(&words[2 * (*wordCount)], value8 + 8 * w, 8);
+        memcpy(&words[2 * (*wordCount) + 1], mask8 + 8 * w, 8);
+        (*wordCount)++;
+    }
+    return TCL_OK;
+}
+
+int FilterSet(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    static const char *actions[] = { "reject", "accept", NULL };
+    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
+    Tcl_Obj **objRules;
+    int ruleCount, defaultAccept, wordCount = 0;
+    HandleInfo *info;
+    Filter *filter;
+
+    if (objc != 4) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle default rules");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetWideIntFromObj(interp, objv[1], &handle) != TCL_OK ||
+        Tcl_GetIndexFromObj(interp, objv[2], actions, "action", 0, &defaultAccept) != TCL_OK ||
+        Tcl_ListObjGetElements(interp, objv[3], &ruleCount, &objRules) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (ruleCount > FILTER_MAX_RULES) {
+        Tcl_AppendResult(interp, "NTCAN too many filter rules", NULL);
+        return TCL_ERROR;
+    }
+
+    filter = (Filter *)ckalloc(sizeof(Filter));
+    filter->count = ruleCount;
+    filter->defaultAccept = defaultAccept;
+    filter->defaultHits = 0;
+    filter->rules = (FilterRule *)ckalloc((ruleCount + 1) * sizeof(FilterRule));
+    filter->words = (uint64_t *)ckalloc((ruleCount * 8 + 1) * 2 * sizeof(uint64_t));
+    filter->hits = (Tcl_WideInt *)ckalloc((ruleCount + 1) * sizeof(Tcl_WideInt));
+    memset(filter->hits, 0, (ruleCount + 1) * sizeof(Tcl_WideInt));
+    for (int i = 0; i < ruleCount; i++) {
+        if (FilterCompileRule(interp, objRules[i], &filter->rules[i], filter->words, &wordCount) != TCL_OK) {
+            FreeFilter(filter);
+            return TCL_ERROR;
+        }
+    }
+
+    info = GetHandleInfo(handle, 1);
+    if (info->filter != NULL) {
+        FreeFilter(info->filter);
+    }
+    info->filter = filter;
+    return TCL_OK;
+}
+
+int FilterClear(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
+    HandleInfo *info;
+
+    if (objc != 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetWideIntFromObj(interp, objv[1], &handle) != TCL_OK) {
+        return TCL_ERROR;
+    }
+
+    info = GetHandleInfo(handle, 0);
+    if (info != NULL && info->filter != NULL) {
+        FreeFilter(info->filter);
+        info->filter = NULL;
+    }
+    return TCL_OK;
+}
+
+int FilterStats(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
+    HandleInfo *info;
+    Filter *filter;
+
+    if (objc != 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetWideIntFromObj(interp, objv[1], &handle) != TCL_OK) {
+        return TCL_ERROR;
+    }
+
+    info = GetHandleInfo(handle, 0);
+    if (info == NULL || info->filter == NULL) {
+        Tcl_AppendResult(interp, "NTCAN no filter set on this handle", NULL);
+        return TCL_ERROR;
+    }
+    filter = info->filter;
+
+    Tcl_Obj *objResult = Tcl_GetObjResult(interp);
+    for (int i = 0; i < filter->count; i++) {
+        Tcl_ListObjAppendElement(interp, objResult, Tcl_NewWideIntObj(filter->hits[i]));
+    }
+    Tcl_ListObjAppendElement(interp, objResult, Tcl_NewWideIntObj(filter->defaultHits));
+    return TCL_OK;
+}
+
 int FlushRxFifo(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
     TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
     NTCAN_RESULT retvalue;                    /* Return values of NTCAN API calls */
@@ -601,20 +1411,405 @@ int GetCtrlStatus(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const
     }
 }
 
-int Read(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
-    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
-    CMSG cmsg;                                /* Buffer for can messages */
-    int32_t count = 1;                        /* # of messages for canRead() */
-    NTCAN_RESULT retvalue;                    /* Return values of NTCAN API calls */
+/*
+ * Health monitor: a native thread samples the controller state and bus
+ * statistic of a handle into a fixed-size ring and only wakes Tcl when a
+ * threshold is crossed (edge triggered, not once per sample).
+ */
 
-    if (objc != 2) {
+#define MONITOR_MAX_DEPTH 65536
+
+#define MONITOR_TRIP_ERROR   0x01             /* Rx or Tx error counter >= errorLimit */
+#define MONITOR_TRIP_OVERRUN 0x02             /* Overruns per sample >= overrunLimit */
+#define MONITOR_TRIP_BUSOFF  0x04             /* Controller entered bus-off */
+
+typedef struct MonitorSample {
+    Tcl_WideInt time;                         /* Sample time in ms */
+    NTCAN_CTRL_STATE ctrlState;               /* Error counters and bus state */
+    NTCAN_BUS_STATISTIC busStatistic;         /* Cumulative bus statistic */
+    uint32_t ctrlOvrDelta;                    /* Counter increments since previous sample */
+    uint32_t fifoOvrDelta;
+    uint32_t errFramesDelta;
+    uint32_t abortedFramesDelta;
+} MonitorSample;
+
+typedef struct Monitor {
+    NTCAN_HANDLE handle;                      /* CAN handle returned by canOpen() */
+    int interval;                             /* Sampling period in ms */
+    int errorLimit;                           /* Error counter threshold, 0 = off */
+    int overrunLimit;                         /* Overrun threshold per sample, 0 = off */
+    Tcl_Interp *interp;                       /* Interpreter for the callback */
+    Tcl_Obj *command;                         /* Callback script or NULL */
+    Tcl_ThreadId ownerId;                     /* Thread owning interp */
+    Tcl_ThreadId threadId;                    /* Sampling thread */
+    unsigned long serial;                     /* Identifies this monitor in queued events */
+    Tcl_Mutex mutex;                          /* Protects the fields below */
+    Tcl_Condition cond;                       /* Signalled on stop */
+    int stop;
+    MonitorSample *ring;                      /* Sample ring of depth entries */
+    int depth;
+    int head;                                 /* Index of the oldest sample */
+    int count;                                /* Samples currently in the ring */
+    Tcl_WideInt samples;                      /* Samples taken in total */
+    Tcl_WideInt lost;                         /* Samples overwritten before MonitorRead */
+    Tcl_WideInt trips;                        /* Threshold crossings reported */
+    int tripped;                              /* MONITOR_TRIP_* conditions currently active */
+    NTCAN_RESULT lastError;                   /* Last failing canIoctl() result */
+} Monitor;
+
+typedef struct MonitorEvent {
+    Tcl_Event header;
+    TCL_NTCAN_HANDLE handle;
+    unsigned long serial;
+    int reason;                               /* One MONITOR_TRIP_* bit */
+    MonitorSample sample;
+} MonitorEvent;
+
+static unsigned long monitorSerial = 0;
+
+static Tcl_Obj *MonitorSampleObj(MonitorSample *sample) {
+    Tcl_Obj *objSample = Tcl_NewListObj(0, NULL);
+
+    Tcl_ListObjAppendElement(NULL, objSample, Tcl_NewWideIntObj(sample->time));
+    Tcl_ListObjAppendElement(NULL, objSample, Tcl_NewIntObj(sample->ctrlState.rcv_err_counter));
+    Tcl_ListObjAppendElement(NULL, objSample, Tcl_NewIntObj(sample->ctrlState.xmit_err_counter));
+    Tcl_ListObjAppendElement(NULL, objSample, Tcl_NewIntObj(sample->ctrlState.status));
+    Tcl_ListObjAppendElement(NULL, objSample, Tcl_NewLongObj(sample->busStatistic.ctrl_ovr));
+    Tcl_ListObjAppendElement(NULL, objSample, Tcl_NewLongObj(sample->busStatistic.fifo_ovr));
+    Tcl_ListObjAppendElement(NULL, objSample, Tcl_NewLongObj(sample->busStatistic.err_frames));
+    Tcl_ListObjAppendElement(NULL, objSample, Tcl_NewLongObj(sample->busStatistic.aborted_frames));
+    Tcl_ListObjAppendElement(NULL, objSample, Tcl_NewLongObj(sample->ctrlOvrDelta));
+    Tcl_ListObjAppendElement(NULL, objSample, Tcl_NewLongObj(sample->fifoOvrDelta));
+    Tcl_ListObjAppendElement(NULL, objSample, Tcl_NewLongObj(sample->errFramesDelta));
+    Tcl_ListObjAppendElement(NULL, objSample, Tcl_NewLongObj(sample->abortedFramesDelta));
+    return objSample;
+}
+
+static int MonitorEventProc(Tcl_Event *evPtr, int flags) {
+    MonitorEvent *event = (MonitorEvent *)evPtr;
+    HandleInfo *info = GetHandleInfo(event->handle, 0);
+    Monitor *mon;
+    Tcl_Obj *args[3];
+
+    /* Drop events of a monitor that was stopped in the meantime */
+    if (info == NULL || info->monitor == NULL || info->monitor->serial != event->serial) {
+        return 1;
+    }
+    mon = info->monitor;
+    if (mon->command == NULL) {
+        return 1;
+    }
+
+    args[0] = Tcl_NewWideIntObj(event->handle);
+    args[1] = Tcl_NewStringObj(event->reason == MONITOR_TRIP_ERROR ? "error" :
+                               event->reason == MONITOR_TRIP_OVERRUN ? "overrun" : "busoff", -1);
+    args[2] = MonitorSampleObj(&event->sample);
+    InvokeCallback(mon->interp, mon->command, 3, args);
+    return 1;
+}
+
+static Tcl_ThreadCreateType MonitorThread(ClientData cData) {
+    Monitor *mon = (Monitor *)cData;
+    MonitorSample sample;
+    NTCAN_BUS_STATISTIC previous;
+    NTCAN_RESULT retvalue;
+    Tcl_Time delay;
+    int havePrevious = 0;
+    int tripped, reason;
+
+    PERF_WORKER("monitor", mon->handle);
+    delay.sec = mon->interval / 1000;
+    delay.usec = (mon->interval % 1000) * 1000;
+
+    Tcl_MutexLock(&mon->mutex);
+    while (!mon->stop) {
+        Tcl_MutexUnlock(&mon->mutex);
+
+        memset(&sample, 0, sizeof(sample));
+        sample.time = GetTimeUs() / 1000;
+        retvalue = canIoctl(mon->handle, NTCAN_IOCTL_GET_CTRL_STATUS, &sample.ctrlState);
+        if (retvalue == NTCAN_SUCCESS) {
+            retvalue = canIoctl(mon->handle, NTCAN_IOCTL_GET_BUS_STATISTIC, &sample.busStatistic);
+        }
+
+        Tcl_MutexLock(&mon->mutex);
+        if (retvalue != NTCAN_SUCCESS) {
+            mon->lastError = retvalue;
+        } else {
+            if (havePrevious) {
+                sample.ctrlOvrDelta = sample.busStatistic.ctrl_ovr - previous.ctrl_ovr;
+                sample.fifoOvrDelta = sample.busStatistic.fifo_ovr - previous.fifo_ovr;
+                sample.errFramesDelta = sample.busStatistic.err_frames - previous.err_frames;
+                sample.abortedFramesDelta = sample.busStatistic.aborted_frames - previous.aborted_frames;
+            }
+            previous = sample.busStatistic;
+            havePrevious = 1;
+
+            if (mon->count == mon->depth) {
+                mon->head = (mon->head + 1) % mon->depth;
+                mon->count--;
+                mon->lost++;
+            }
+            mon->ring[(mon->head + mon->count) % mon->depth] = sample;
+            mon->count++;
+            mon->samples++;
+
+            tripped = 0;
+            if (mon->errorLimit > 0 && (sample.ctrlState.rcv_err_counter >= mon->errorLimit ||
+                                        sample.ctrlState.xmit_err_counter >= mon->errorLimit)) {
+                tripped |= MONITOR_TRIP_ERROR;
+            }
+            if (mon->overrunLimit > 0 &&
+                sample.ctrlOvrDelta + sample.fifoOvrDelta >= (uint32_t)mon->overrunLimit) {
+                tripped |= MONITOR_TRIP_OVERRUN;
+            }
+            if ((sample.ctrlState.status & NTCAN_BUSSTATE_BUSOFF) == NTCAN_BUSSTATE_BUSOFF) {
+                tripped |= MONITOR_TRIP_BUSOFF;
+            }
+
+            /* Report only conditions that were not active at the previous sample */
+            if (mon->command != NULL) {
+                for (reason = MONITOR_TRIP_ERROR; reason <= MONITOR_TRIP_BUSOFF; reason <<= 1) {
+                    if ((tripped & reason) && !(mon->tripped & reason)) {
+                        MonitorEvent *event = (MonitorEvent *)ckalloc(sizeof(MonitorEvent));
+                        event->header.proc = MonitorEventProc;
+                        event->handle = (TCL_NTCAN_HANDLE)mon->handle;
+                        event->serial = mon->serial;
+                        event->reason = reason;
+                        event->sample = sample;
+                        Tcl_ThreadQueueEvent(mon->ownerId, (Tcl_Event *)event, TCL_QUEUE_TAIL);
+                        Tcl_ThreadAlert(mon->ownerId);
+                        mon->trips++;
+                    }
+                }
+            }
+            mon->tripped = tripped;
+        }
+
+        if (!mon->stop) {
+            Tcl_ConditionWait(&mon->cond, &mon->mutex, &delay);
+        }
+    }
+    Tcl_MutexUnlock(&mon->mutex);
+
+    PERF_WORKER_DONE();
+    TCL_THREAD_CREATE_RETURN;
+}
+
+static void StopMonitor(Monitor *mon) {
+    int result;
+
+    Tcl_MutexLock(&mon->mutex);
+    mon->stop = 1;
+    Tcl_ConditionNotify(&mon->cond);
+    Tcl_MutexUnlock(&mon->mutex);
+    Tcl_JoinThread(mon->threadId, &result);
+
+    Tcl_ConditionFinalize(&mon->cond);
+    Tcl_MutexFinalize(&mon->mutex);
+    if (mon->command != NULL) {
+        Tcl_DecrRefCount(mon->command);
+    }
+    Tcl_Release(mon->interp);
+    ckfree((char *)mon->ring);
+    ckfree((char *)mon);
+}
+
+int MonitorStart(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
+    int interval;                             /* Sampling period in ms */
+    int depth;                                /* Number of samples kept */
+    int errorLimit;                           /* Error counter threshold */
+    int overrunLimit;                         /* Overrun threshold per sample */
+    HandleInfo *info;
+    Monitor *mon;
+
+    if (objc != 6 && objc != 7) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle interval depth errorLimit overrunLimit ?command?");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetWideIntFromObj(interp, objv[1], &handle) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[2], &interval) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[3], &depth) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[4], &errorLimit) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[5], &overrunLimit) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (interval < 1) {
+        Tcl_AppendResult(interp, "NTCAN monitor interval must be >= 1 ms", NULL);
+        return TCL_ERROR;
+    }
+    if (depth < 1 || depth > MONITOR_MAX_DEPTH) {
+        Tcl_AppendResult(interp, "NTCAN monitor depth out of range", NULL);
+        return TCL_ERROR;
+    }
+
+    info = GetHandleInfo(handle, 1);
+    if (info->monitor != NULL) {
+        Tcl_AppendResult(interp, "NTCAN monitor already running on this handle", NULL);
+        return TCL_ERROR;
+    }
+
+    mon = (Monitor *)ckalloc(sizeof(Monitor));
+    memset(mon, 0, sizeof(Monitor));
+    mon->handle = (NTCAN_HANDLE)handle;
+    mon->interval = interval;
+    mon->errorLimit = errorLimit;
+    mon->overrunLimit = overrunLimit;
+    mon->interp = interp;
+    Tcl_Preserve(interp);
+    if (objc == 7) {
+        mon->command = objv[6];
+        Tcl_IncrRefCount(mon->command);
+    }
+    mon->ownerId = Tcl_GetCurrentThread();
+    mon->serial = ++monitorSerial;
+    mon->ring = (MonitorSample *)ckalloc(depth * sizeof(MonitorSample));
+    mon->depth = depth;
+
+    if (Tcl_CreateThread(&mon->threadId, MonitorThread, mon,
+                         TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE) != TCL_OK) {
+        if (mon->command != NULL) {
+            Tcl_DecrRefCount(mon->command);
+        }
+        Tcl_Release(interp);
+        ckfree((char *)mon->ring);
+        ckfree((char *)mon);
+        Tcl_AppendResult(interp, "NTCAN cannot create monitor thread", NULL);
+        return TCL_ERROR;
+    }
+    info->monitor = mon;
+    return TCL_OK;
+}
+
+int MonitorStop(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
+    HandleInfo *info;
+
+    if (objc != 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetWideIntFromObj(interp, objv[1], &handle) != TCL_OK) {
+        return TCL_ERROR;
+    }
+
+    info = GetHandleInfo(handle, 0);
+    if (info == NULL || info->monitor == NULL) {
+        Tcl_AppendResult(interp, "NTCAN no monitor running on this handle", NULL);
+        return TCL_ERROR;
+    }
+    StopMonitor(info->monitor);
+    info->monitor = NULL;
+    return TCL_OK;
+}
+
+int MonitorRead(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
+    HandleInfo *info;
+    Monitor *mon;
+    MonitorSample *samples;
+    int count, i;
+
+    if (objc != 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetWideIntFromObj(interp, objv[1], &handle) != TCL_OK) {
+        return TCL_ERROR;
+    }
+
+    info = GetHandleInfo(handle, 0);
+    if (info == NULL || info->monitor == NULL) {
+        Tcl_AppendResult(interp, "NTCAN no monitor running on this handle", NULL);
+        return TCL_ERROR;
+    }
+    mon = info->monitor;
+
+    /* Drain the ring under the lock, build the Tcl objects outside of it */
+    Tcl_MutexLock(&mon->mutex);
+    count = mon->count;
+    samples = (MonitorSample *)ckalloc((count ? count : 1) * sizeof(MonitorSample));
+    for (i = 0; i < count; i++) {
+        samples[i] = mon->ring[(mon->head + i) % mon->depth];
+    }
+    mon->head = 0;
+    mon->count = 0;
+    Tcl_MutexUnlock(&mon->mutex);
+
+    Tcl_Obj *objResult = Tcl_GetObjResult(interp);
+    for (i = 0; i < count; i++) {
+        Tcl_ListObjAppendElement(interp, objResult, MonitorSampleObj(&samples[i]));
+    }
+    ckfree((char *)samples);
+    return TCL_OK;
+}
+
+int MonitorInfo(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
+    HandleInfo *info;
+    Monitor *mon;
+
+    if (objc != 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetWideIntFromObj(interp, objv[1], &handle) != TCL_OK) {
+        return TCL_ERROR;
+    }
+
+    info = GetHandleInfo(handle, 0);
+    if (info == NULL || info->monitor == NULL) {
+        Tcl_AppendResult(interp, "NTCAN no monitor running on this handle", NULL);
+        return TCL_ERROR;
+    }
+    mon = info->monitor;
+
+    Tcl_MutexLock(&mon->mutex);
+    Tcl_WideInt samples = mon->samples;
+    Tcl_WideInt lost = mon->lost;
+    Tcl_WideInt trips = mon->trips;
+    int tripped = mon->tripped;
+    NTCAN_RESULT lastError = mon->lastError;
+    Tcl_MutexUnlock(&mon->mutex);
+
+    Tcl_Obj *objResult = Tcl_GetObjResult(interp);
+    Tcl_ListObjAppendElement(interp, objResult, Tcl_NewWideIntObj(samples));
+    Tcl_ListObjAppendElement(interp, objResult, Tcl_NewWideIntObj(lost));
+    Tcl_ListObjAppendElement(interp, objResult, Tcl_NewWideIntObj(trips));
+    Tcl_ListObjAppendElement(interp, objResult, Tcl_NewIntObj(tripped));
+    Tcl_ListObjAppendElement(interp, objResult, Tcl_NewIntObj(lastError));
+    return TCL_OK;
+}
+
+int Read(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
+    CMSG cmsg;                                /* Buffer for can messages */
+    int32_t count = 1;                        /* # of messages for canRead() */
+    NTCAN_RESULT retvalue;                    /* Return values of NTCAN API calls */
+    Tcl_WideInt deadline = 0;                 /* Bound for skipping filtered frames */
+    HandleInfo *info;
+
+    if (objc != 2) {
         Tcl_WrongNumArgs(interp, 1, objv, "handle");
         return TCL_ERROR;
     }
     Tcl_GetWideIntFromObj(interp, objv[1], &handle);
+    info = GetHandleInfo(handle, 0);
 
     retvalue = canRead((NTCAN_HANDLE)handle, &cmsg, &count, NULL);
 
+    /* Frames rejected by the software filter never become Tcl objects */
+    while (retvalue == NTCAN_SUCCESS && info != NULL && info->filter != NULL &&
+           !FilterAccept(info->filter, cmsg.id, cmsg.len, cmsg.data)) {
+        if (FilterExpired((NTCAN_HANDLE)handle, &deadline)) {
+            retvalue = NTCAN_RX_TIMEOUT;
+            break;
+        }
+        count = 1;
+        retvalue = canRead((NTCAN_HANDLE)handle, &cmsg, &count, NULL);
+    }
+
     if (retvalue == NTCAN_RX_TIMEOUT) {
         Tcl_AppendResult(interp, "NTCAN canRead() returned timeout", NULL);
         return TCL_ERROR;
@@ -622,11 +1817,13 @@ int Read(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
         FormatError(interp, "canRead", retvalue);
         return TCL_ERROR;
     } else {
+        PERF_START(perf);
         Tcl_Obj *objResult = Tcl_GetObjResult(interp);
         Tcl_ListObjAppendElement(interp, objResult, Tcl_NewLongObj(cmsg.id));
         Tcl_ListObjAppendElement(interp, objResult, Tcl_NewIntObj(cmsg.len & 0xF0));
         Tcl_ListObjAppendElement(interp, objResult, Tcl_NewIntObj(NTCAN_LEN_TO_DATASIZE(cmsg.len)));
         Tcl_ListObjAppendElement(interp, objResult, Tcl_NewByteArrayObj(cmsg.data, NTCAN_LEN_TO_DATASIZE(cmsg.len)));
+        PERF_STOP(handle, perf);
         return TCL_OK;
     }
 }
@@ -641,6 +1838,7 @@ int Write(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
         Tcl_WrongNumArgs(interp, 1, objv, "handle id mode data");
         return TCL_ERROR;
     }
+    PERF_START(perf);
     Tcl_GetWideIntFromObj(interp, objv[1], &handle);
     Tcl_GetIntFromObj(interp, objv[2], &(cmsg.id));
     int mode;
@@ -659,6 +1857,7 @@ int Write(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
             cmsg.data[i] = tclData[i];
         }
 
+    PERF_STOP(handle, perf);
     retvalue = canWrite((NTCAN_HANDLE)handle, &cmsg, &count, NULL);
 
     if (retvalue != NTCAN_SUCCESS) {
@@ -674,15 +1873,29 @@ int ReadX(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
     CMSG_X cmsg;                              /* Buffer for can messages */
     int32_t count = 1;                        /* # of messages for canRead() */
     NTCAN_RESULT retvalue;                    /* Return values of NTCAN API calls */
+    Tcl_WideInt deadline = 0;                 /* Bound for skipping filtered frames */
+    HandleInfo *info;
 
     if (objc != 2) {
         Tcl_WrongNumArgs(interp, 1, objv, "handle");
         return TCL_ERROR;
     }
     Tcl_GetWideIntFromObj(interp, objv[1], &handle);
+    info = GetHandleInfo(handle, 0);
 
     retvalue = canReadX((NTCAN_HANDLE)handle, &cmsg, &count, NULL);
 
+    /* Frames rejected by the software filter never become Tcl objects */
+    while (retvalue == NTCAN_SUCCESS && info != NULL && info->filter != NULL &&
+           !FilterAccept(info->filter, cmsg.id, cmsg.len, cmsg.data)) {
+        if (FilterExpired((NTCAN_HANDLE)handle, &deadline)) {
+            retvalue = NTCAN_RX_TIMEOUT;
+            break;
+        }
+        count = 1;
+        retvalue = canReadX((NTCAN_HANDLE)handle, &cmsg, &count, NULL);
+    }
+
     if (retvalue == NTCAN_RX_TIMEOUT) {
         Tcl_AppendResult(interp, "NTCAN canReadX() returned timeout", NULL);
         return TCL_ERROR;
@@ -690,15 +1903,146 @@ int ReadX(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
         FormatError(interp, "canRead", retvalue);
         return TCL_ERROR;
     } else {
+        PERF_START(perf);
         Tcl_Obj *objResult = Tcl_GetObjResult(interp);
         Tcl_ListObjAppendElement(interp, objResult, Tcl_NewLongObj(cmsg.id));
         Tcl_ListObjAppendElement(interp, objResult, Tcl_NewIntObj(cmsg.len & 0xF0));
         Tcl_ListObjAppendElement(interp, objResult, Tcl_NewIntObj(NTCAN_LEN_TO_DATASIZE(cmsg.len)));
         Tcl_ListObjAppendElement(interp, objResult, Tcl_NewByteArrayObj(cmsg.data, NTCAN_LEN_TO_DATASIZE(cmsg.len)));
+        PERF_STOP(handle, perf);
         return TCL_OK;
     }
 }
 
+/*
+ * Bulk reads return a whole batch in a handful of objects instead of a list
+ * and four objects per frame: either one byte array of fixed-size records
+ * or a set of columns.
+ */
+
+#define READ_BULK_MAX    4096                 /* Frames per ReadBulk call */
+#define READ_BULK_RECORD 80                   /* Bytes per packed record */
+
+static void PutLE(unsigned char *buf, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        buf[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+int ReadBulk(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    static const char *formats[] = { "packed", "columnar", NULL };
+    enum { FORMAT_PACKED, FORMAT_COLUMNAR };
+    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
+    CMSG_X *cmsg;                             /* Buffer for can messages */
+    int32_t count;                            /* # of messages for canReadX() */
+    NTCAN_RESULT retvalue;                    /* Return values of NTCAN API calls */
+    Tcl_WideInt deadline = 0;                 /* Bound for skipping filtered frames */
+    HandleInfo *info;
+    int maxMessages, format, accepted, size;
+
+    if (objc != 4) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle maxMessages format");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetWideIntFromObj(interp, objv[1], &handle) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[2], &maxMessages) != TCL_OK ||
+        Tcl_GetIndexFromObj(interp, objv[3], formats, "format", 0, &format) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (maxMessages < 1 || maxMessages > READ_BULK_MAX) {
+        Tcl_AppendResult(interp, "NTCAN ReadBulk() maxMessages out of range", NULL);
+        return TCL_ERROR;
+    }
+    info = GetHandleInfo(handle, 0);
+    cmsg = (CMSG_X *)ckalloc(maxMessages * sizeof(CMSG_X));
+
+    /* Compact the batch in place, dropping frames rejected by the filter */
+    do {
+        count = maxMessages;
+        retvalue = canReadX((NTCAN_HANDLE)handle, cmsg, &count, NULL);
+        accepted = count;
+        if (retvalue == NTCAN_SUCCESS && info != NULL && info->filter != NULL) {
+            accepted = 0;
+            for (int i = 0; i < count; i++) {
+                if (FilterAccept(info->filter, cmsg[i].id, cmsg[i].len, cmsg[i].data)) {
+                    if (accepted != i) {
+                        cmsg[accepted] = cmsg[i];
+                    }
+                    accepted++;
+                }
+            }
+            if (accepted == 0 && FilterExpired((NTCAN_HANDLE)handle, &deadline)) {
+                retvalue = NTCAN_RX_TIMEOUT;
+            }
+        }
+    } while (retvalue == NTCAN_SUCCESS && accepted == 0);
+
+    if (retvalue == NTCAN_RX_TIMEOUT) {
+        ckfree((char *)cmsg);
+        Tcl_AppendResult(interp, "NTCAN canReadX() returned timeout", NULL);
+        return TCL_ERROR;
+    } else if (retvalue != NTCAN_SUCCESS) {
+        ckfree((char *)cmsg);
+        FormatError(interp, "canReadX", retvalue);
+        return TCL_ERROR;
+    }
+
+    PERF_START(perf);
+    if (format == FORMAT_PACKED) {
+        Tcl_Obj *objResult = Tcl_NewByteArrayObj(NULL, 0);
+        unsigned char *rec = Tcl_SetByteArrayLength(objResult, accepted * READ_BULK_RECORD);
+
+        memset(rec, 0, accepted * READ_BULK_RECORD);
+        for (int i = 0; i < accepted; i++, rec += READ_BULK_RECORD) {
+            size = NTCAN_LEN_TO_DATASIZE(cmsg[i].len);
+            PutLE(rec, (uint32_t)cmsg[i].id, 4);
+            rec[4] = cmsg[i].len & 0xF0;
+            rec[5] = size;
+            PutLE(rec + 8, cmsg[i].timestamp, 8);
+            memcpy(rec + 16, cmsg[i].data, size);
+        }
+        Tcl_SetObjResult(interp, objResult);
+    } else {
+        Tcl_Obj *objIds = Tcl_NewByteArrayObj(NULL, 0);
+        Tcl_Obj *objFlags = Tcl_NewByteArrayObj(NULL, 0);
+        Tcl_Obj *objStamps = Tcl_NewByteArrayObj(NULL, 0);
+        Tcl_Obj *objData = Tcl_NewByteArrayObj(NULL, 0);
+        Tcl_Obj *objOffsets = Tcl_NewByteArrayObj(NULL, 0);
+        unsigned char *ids = Tcl_SetByteArrayLength(objIds, accepted * 4);
+        unsigned char *flags = Tcl_SetByteArrayLength(objFlags, accepted);
+        unsigned char *stamps = Tcl_SetByteArrayLength(objStamps, accepted * 8);
+        unsigned char *offsets = Tcl_SetByteArrayLength(objOffsets, (accepted + 1) * 4);
+        int total = 0;
+
+        for (int i = 0; i < accepted; i++) {
+            total += NTCAN_LEN_TO_DATASIZE(cmsg[i].len);
+        }
+        unsigned char *data = Tcl_SetByteArrayLength(objData, total);
+
+        total = 0;
+        for (int i = 0; i < accepted; i++) {
+            size = NTCAN_LEN_TO_DATASIZE(cmsg[i].len);
+            PutLE(ids + i * 4, (uint32_t)cmsg[i].id, 4);
+            flags[i] = cmsg[i].len & 0xF0;
+            PutLE(stamps + i * 8, cmsg[i].timestamp, 8);
+            PutLE(offsets + i * 4, (uint32_t)total, 4);
+            memcpy(data + total, cmsg[i].data, size);
+            total += size;
+        }
+        PutLE(offsets + accepted * 4, (uint32_t)total, 4);
+
+        Tcl_Obj *objResult = Tcl_GetObjResult(interp);
+        Tcl_ListObjAppendElement(interp, objResult, objIds);
+        Tcl_ListObjAppendElement(interp, objResult, objFlags);
+        Tcl_ListObjAppendElement(interp, objResult, objStamps);
+        Tcl_ListObjAppendElement(interp, objResult, objData);
+        Tcl_ListObjAppendElement(interp, objResult, objOffsets);
+    }
+    PERF_STOP(handle, perf);
+    ckfree((char *)cmsg);
+    return TCL_OK;
+}
+
 int WriteX(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
     TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
     CMSG_X cmsg;                              /* Buffer for can messages */
@@ -709,6 +2053,7 @@ int WriteX(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]
         Tcl_WrongNumArgs(interp, 1, objv, "handle id mode data");
         return TCL_ERROR;
     }
+    PERF_START(perf);
     Tcl_GetWideIntFromObj(interp, objv[1], &handle);
     Tcl_GetIntFromObj(interp, objv[2], &(cmsg.id));
     int mode;
@@ -727,6 +2072,7 @@ int WriteX(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]
             cmsg.data[i] = tclData[i];
         }
 
+    PERF_STOP(handle, perf);
     retvalue = canWriteX((NTCAN_HANDLE)handle, &cmsg, &count, NULL);
 
     if (retvalue != NTCAN_SUCCESS) {
@@ -737,56 +2083,1965 @@ int WriteX(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]
     }
 }
 
-int Status(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+/*
+ * Asynchronous transmit queue: frames are queued natively and written by a
+ * per-handle thread, so a full Tx FIFO or a bus without acknowledge never
+ * blocks the interpreter. Completion is reported per range of sequence
+ * numbers, which keeps callbacks cheap at high frame rates.
+ */
+
+#define TXQUEUE_MAX_DEPTH 65536
+#define TXQUEUE_BATCH     32                  /* Frames per canWriteX() call */
+
+typedef struct TxQueue {
+    NTCAN_HANDLE handle;                      /* CAN handle returned by canOpen() */
+    Tcl_Interp *interp;                       /* Interpreter for the callback */
+    Tcl_Obj *command;                         /* Callback script or NULL */
+    Tcl_ThreadId ownerId;                     /* Thread owning interp */
+    Tcl_ThreadId threadId;                    /* Transmit thread */
+    unsigned long serial;                     /* Identifies this queue in queued events */
+    Tcl_Mutex mutex;                          /* Protects the fields below */
+    Tcl_Condition cond;                       /* Signalled on new frames and on stop */
+    int stop;
+    CMSG_X *ring;                             /* Frame ring of depth entries */
+    int depth;
+    int head;                                 /* Index of the oldest queued frame */
+    int count;                                /* Frames waiting in the ring */
+    int inFlight;                             /* Frames handed to canWriteX() */
+    Tcl_WideInt headSeq;                      /* Sequence number of ring[head] */
+    Tcl_WideInt sent;                         /* Frames confirmed by the driver */
+    Tcl_WideInt failed;                       /* Frames not transmitted */
+    Tcl_WideInt rejected;                     /* TxQueueSend calls refused on a full queue */
+    NTCAN_RESULT lastError;                   /* Last failing canWriteX() result */
+} TxQueue;
+
+typedef struct TxQueueEvent {
+    Tcl_Event header;
+    TCL_NTCAN_HANDLE handle;
+    unsigned long serial;
+    Tcl_WideInt first;                        /* Sequence number range reported */
+    Tcl_WideInt last;
+    NTCAN_RESULT result;
+} TxQueueEvent;
+
+static unsigned long txQueueSerial = 0;
+
+static int TxQueueEventProc(Tcl_Event *evPtr, int flags) {
+    TxQueueEvent *event = (TxQueueEvent *)evPtr;
+    HandleInfo *info = GetHandleInfo(event->handle, 0);
+    TxQueue *q;
+    Tcl_Obj *args[4];
+
+    /* Drop events of a queue that was stopped in the meantime */
+    if (info == NULL || info->txqueue == NULL || info->txqueue->serial != event->serial) {
+        return 1;
+    }
+    q = info->txqueue;
+
+    args[0] = Tcl_NewWideIntObj(event->handle);
+    args[1] = Tcl_NewWideIntObj(event->first);
+    args[2] = Tcl_NewWideIntObj(event->last);
+    args[3] = Tcl_NewStringObj(event->result == NTCAN_SUCCESS ? "ok" :
+                               event->result == NTCAN_TX_TIMEOUT ? "timeout" : "error", -1);
+    InvokeCallback(q->interp, q->command, 4, args);
+    return 1;
+}
+
+static void TxQueueReport(TxQueue *q, Tcl_WideInt first, Tcl_WideInt last, NTCAN_RESULT result) {
+    TxQueueEvent *event = (TxQueueEvent *)ckalloc(sizeof(TxQueueEvent));
+
+    event->header.proc = TxQueueEventProc;
+    event->handle = (TCL_NTCAN_HANDLE)q->handle;
+    event->serial = q->serial;
+    event->first = first;
+    event->last = last;
+    event->result = result;
+    Tcl_ThreadQueueEvent(q->ownerId, (Tcl_Event *)event, TCL_QUEUE_TAIL);
+    Tcl_ThreadAlert(q->ownerId);
+}
+
+static Tcl_ThreadCreateType TxQueueThread(ClientData cData) {
+    TxQueue *q = (TxQueue *)cData;
+    CMSG_X frames[TXQUEUE_BATCH];
+    NTCAN_RESULT retvalue;
+    Tcl_WideInt first;
+    int32_t count;
+    int n;
+
+    PERF_WORKER("txqueue", q->handle);
+    Tcl_MutexLock(&q->mutex);
+    for (;;) {
+        while (!q->stop && q->count == 0) {
+            Tcl_ConditionWait(&q->cond, &q->mutex, NULL);
+        }
+        if (q->stop) {
+            break;
+        }
+
+        /* Take a batch out of the ring, write it without holding the lock */
+        n = q->count < TXQUEUE_BATCH ? q->count : TXQUEUE_BATCH;
+        for (int i = 0; i < n; i++) {
+            frames[i] = q->ring[(q->head + i) % q->depth];
+        }
+        first = q->headSeq;
+        q->head = (q->head + n) % q->depth;
+        q->count -= n;
+        q->headSeq += n;
+        q->inFlight = n;
+        Tcl_MutexUnlock(&q->mutex);
+
+        count = n;
+        retvalue = canWriteX(q->handle, frames, &count, NULL);
+        if (retvalue == NTCAN_SUCCESS) {
+            count = n;
+        } else if (count < 0 || count > n) {
+            count = 0;
+        }
+
+        Tcl_MutexLock(&q->mutex);
+        q->inFlight = 0;
+        q->sent += count;
+        if (retvalue != NTCAN_SUCCESS) {
+            q->failed += n - count;
+            q->lastError = retvalue;
+        }
+        if (q->command != NULL && !q->stop) {
+            if (count > 0) {
+                TxQueueReport(q, first, first + count - 1, NTCAN_SUCCESS);
+            }
+            if (count < n) {
+                TxQueueReport(q, first + count, first + n - 1, retvalue);
+            }
+        }
+    }
+    Tcl_MutexUnlock(&q->mutex);
+
+    PERF_WORKER_DONE();
+    TCL_THREAD_CREATE_RETURN;
+}
+
+static void StopTxQueue(TxQueue *q) {
+    int result, writing;
+
+    /*
+     * Queued frames are discarded. A canWriteX() in progress ends within the
+     * Tx timeout; aborting only after the join cannot miss a write that is
+     * just starting, and clears what it left in the driver.
+     */
+    Tcl_MutexLock(&q->mutex);
+    q->stop = 1;
+    writing = q->inFlight > 0;
+    Tcl_ConditionNotify(&q->cond);
+    Tcl_MutexUnlock(&q->mutex);
+    Tcl_JoinThread(q->threadId, &result);
+    if (writing) {
+        canIoctl(q->handle, NTCAN_IOCTL_ABORT_TX, NULL);
+    }
+
+    Tcl_ConditionFinalize(&q->cond);
+    Tcl_MutexFinalize(&q->mutex);
+    if (q->command != NULL) {
+        Tcl_DecrRefCount(q->command);
+    }
+    Tcl_Release(q->interp);
+    ckfree((char *)q->ring);
+    ckfree((char *)q);
+}
+
+static TxQueue *GetTxQueue(Tcl_Interp *interp, Tcl_Obj *objHandle) {
     TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
-    NTCAN_RESULT retvalue;                    /* Return values of NTCAN API calls */
-    CAN_IF_STATUS cstat;
-    char statusTxt[STATUS_TXT_LEN];
+    HandleInfo *info;
 
-    if (objc != 2) {
-        Tcl_WrongNumArgs(interp, 1, objv, "handle");
-        return TCL_ERROR;
+    if (Tcl_GetWideIntFromObj(interp, objHandle, &handle) != TCL_OK) {
+        return NULL;
     }
-    Tcl_GetWideIntFromObj(interp, objv[1], &handle);
+    info = GetHandleInfo(handle, 0);
+    if (info == NULL || info->txqueue == NULL) {
+        Tcl_AppendResult(interp, "NTCAN no transmit queue on this handle", NULL);
+        return NULL;
+    }
+    return info->txqueue;
+}
 
-    retvalue = canStatus((NTCAN_HANDLE)handle, &cstat);
+int TxQueueStart(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
+    int depth;                                /* Number of frames queued at most */
+    HandleInfo *info;
+    TxQueue *q;
 
-    if (retvalue != NTCAN_SUCCESS) {
-        FormatError(interp, "canStatus", retvalue);
+    if (objc != 3 && objc != 4) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle depth ?command?");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetWideIntFromObj(interp, objv[1], &handle) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[2], &depth) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (depth < 1 || depth > TXQUEUE_MAX_DEPTH) {
+        Tcl_AppendResult(interp, "NTCAN transmit queue depth out of range", NULL);
         return TCL_ERROR;
-    } else {
-        snprintf(statusTxt, sizeof(statusTxt), "ID=%s\n"
-                 "Dll=%1X.%1X.%02X\n"
-                 "Drv=%1X.%1X.%02X\n"
-                 "FW=%1X.%1X.%02X\n"
-                 "HW=%1X.%1X.%02X\n"
-                 "Status=%08x\n"
-                 "Features=%04x",
-                 cstat.boardid,
-                 cstat.dll     >>12, (cstat.dll     >>8) & 0xf, cstat.dll      & 0xff,
-                 cstat.driver  >>12, (cstat.driver  >>8) & 0xf, cstat.driver   & 0xff,
-                 cstat.firmware>>12, (cstat.firmware>>8) & 0xf, cstat.firmware & 0xff,
-                 cstat.hardware>>12, (cstat.hardware>>8) & 0xf, cstat.hardware & 0xff,
-                 (unsigned long)cstat.boardstatus,
-                 cstat.features);
-        Tcl_AppendResult(interp, &statusTxt, NULL);
-        return TCL_OK;
     }
-}
 
-int Ntcan_Init(Tcl_Interp *interp) {
-    /* initialize Tcl stubs */
-    if (Tcl_InitStubs(interp, "8.6", 0) == NULL)
+    info = GetHandleInfo(handle, 1);
+    if (info->txqueue != NULL) {
+        Tcl_AppendResult(interp, "NTCAN transmit queue already running on this handle", NULL);
         return TCL_ERROR;
+    }
 
-    // create namespace
-    if (Tcl_CreateNamespace(interp, NS_PREFIX, NULL, NULL) == NULL)
+    q = (TxQueue *)ckalloc(sizeof(TxQueue));
+    memset(q, 0, sizeof(TxQueue));
+    q->handle = (NTCAN_HANDLE)handle;
+    q->interp = interp;
+    Tcl_Preserve(interp);
+    if (objc == 4) {
+        q->command = objv[3];
+        Tcl_IncrRefCount(q->command);
+    }
+    q->ownerId = Tcl_GetCurrentThread();
+    q->serial = ++txQueueSerial;
+    q->ring = (CMSG_X *)ckalloc(depth * sizeof(CMSG_X));
+    q->depth = depth;
+    q->headSeq = 1;
+
+    if (Tcl_CreateThread(&q->threadId, TxQueueThread, q,
+                         TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE) != TCL_OK) {
+        if (q->command != NULL) {
+            Tcl_DecrRefCount(q->command);
+        }
+        Tcl_Release(interp);
+        ckfree((char *)q->ring);
+        ckfree((char *)q);
+        Tcl_AppendResult(interp, "NTCAN cannot create transmit thread", NULL);
         return TCL_ERROR;
+    }
+    info->txqueue = q;
+    return TCL_OK;
+}
 
-    // initialize operation
-    Tcl_CreateObjCommand(interp, NS_PREFIX "Scan",               (Tcl_ObjCmdProc *)Scan, 0, 0);
-    Tcl_CreateObjCommand(interp, NS_PREFIX "Open",               (Tcl_ObjCmdProc *)Open, 0, 0);
-    Tcl_CreateObjCommand(interp, NS_PREFIX "Close",              (Tcl_ObjCmdProc *)Close, 0, 0);
+int TxQueueStop(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
+    HandleInfo *info;
+
+    if (objc != 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetWideIntFromObj(interp, objv[1], &handle) != TCL_OK) {
+        return TCL_ERROR;
+    }
+
+    info = GetHandleInfo(handle, 0);
+    if (info == NULL || info->txqueue == NULL) {
+        Tcl_AppendResult(interp, "NTCAN no transmit queue on this handle", NULL);
+        return TCL_ERROR;
+    }
+    StopTxQueue(info->txqueue);
+    info->txqueue = NULL;
+    return TCL_OK;
+}
+
+int TxQueueSend(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    TxQueue *q;
+    CMSG_X *cmsg;
+    Tcl_WideInt seq;
+    int id, mode, dataLen;
+    unsigned char *data;
+
+    if (objc != 5) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle id mode data");
+        return TCL_ERROR;
+    }
+    if ((q = GetTxQueue(interp, objv[1])) == NULL ||
+        Tcl_GetIntFromObj(interp, objv[2], &id) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[3], &mode) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    data = Tcl_GetByteArrayFromObj(objv[4], &dataLen);
+    if (dataLen > 64) {
+        Tcl_AppendResult(interp, "NTCAN TxQueueSend() data length > 64", NULL);
+        return TCL_ERROR;
+    }
+
+    /* Frames being written still count against the depth */
+    Tcl_MutexLock(&q->mutex);
+    if (q->count + q->inFlight >= q->depth) {
+        q->rejected++;
+        Tcl_MutexUnlock(&q->mutex);
+        Tcl_AppendResult(interp, "NTCAN transmit queue full", NULL);
+        return TCL_ERROR;
+    }
+    cmsg = &q->ring[(q->head + q->count) % q->depth];
+    memset(cmsg, 0, sizeof(CMSG_X));
+    cmsg->id = id;
+    cmsg->len = mode | NTCAN_DATASIZE_TO_DLC(dataLen);
+    memcpy(cmsg->data, data, dataLen);
+    seq = q->headSeq + q->count;
+    q->count++;
+    Tcl_ConditionNotify(&q->cond);
+    Tcl_MutexUnlock(&q->mutex);
+
+    Tcl_SetObjResult(interp, Tcl_NewWideIntObj(seq));
+    return TCL_OK;
+}
+
+int TxQueueInfo(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    TxQueue *q;
+
+    if (objc != 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle");
+        return TCL_ERROR;
+    }
+    if ((q = GetTxQueue(interp, objv[1])) == NULL) {
+        return TCL_ERROR;
+    }
+
+    Tcl_MutexLock(&q->mutex);
+    int queued = q->count + q->inFlight;
+    Tcl_WideInt sent = q->sent;
+    Tcl_WideInt failed = q->failed;
+    Tcl_WideInt rejected = q->rejected;
+    NTCAN_RESULT lastError = q->lastError;
+    Tcl_MutexUnlock(&q->mutex);
+
+    Tcl_Obj *objResult = Tcl_GetObjResult(interp);
+    Tcl_ListObjAppendElement(interp, objResult, Tcl_NewIntObj(queued));
+    Tcl_ListObjAppendElement(interp, objResult, Tcl_NewIntObj(q->depth));
+    Tcl_ListObjAppendElement(interp, objResult, Tcl_NewWideIntObj(sent));
+    Tcl_ListObjAppendElement(interp, objResult, Tcl_NewWideIntObj(failed));
+    Tcl_ListObjAppendElement(interp, objResult, Tcl_NewWideIntObj(rejected));
+    Tcl_ListObjAppendElement(interp, objResult, Tcl_NewIntObj(lastError));
+    return TCL_OK;
+}
+
+/*
+ * ISO-TP (ISO 15765-2) transport: segmentation, flow control and separation
+ * time are handled by a native thread that owns the receive path of the
+ * handle, so Tcl only sees whole PDUs.
+ */
+
+#define ISOTP_MAX_PDU     (1024 * 1024)       /* Upper bound for FF escape lengths */
+#define ISOTP_MAX_QUEUED  64                  /* Received PDUs kept until IsoTpReceive */
+#define ISOTP_BATCH       32                  /* Frames per canReadX()/canWriteX() call */
+#define ISOTP_POLL_MS     5                   /* Rx timeout while the channel is open */
+#define ISOTP_PAD_DEFAULT 0xCC                /* Filler for CAN FD frame lengths */
+
+#define ISOTP_PCI_SF 0x0
+#define ISOTP_PCI_FF 0x1
+#define ISOTP_PCI_CF 0x2
+#define ISOTP_PCI_FC 0x3
+
+#define ISOTP_FC_CTS   0x0
+#define ISOTP_FC_WAIT  0x1
+#define ISOTP_FC_OVFLW 0x2
+
+enum { ISOTP_TX_IDLE, ISOTP_TX_WAIT_FC, ISOTP_TX_CF };
+enum { ISOTP_OK, ISOTP_ERR_TIMEOUT, ISOTP_ERR_OVERFLOW, ISOTP_ERR_DRIVER, ISOTP_ERR_CLOSED };
+
+typedef struct IsoTpPdu {
+    struct IsoTpPdu *next;
+    int len;
+    unsigned char data[1];
+} IsoTpPdu;
+
+typedef struct IsoTpChannel {
+    NTCAN_HANDLE handle;                      /* CAN handle returned by canOpen() */
+    int32_t txId;                             /* CAN-ID of transmitted frames */
+    int32_t rxId;                             /* CAN-ID of received frames */
+    int frameSize;                            /* TX_DL: 8 = classic CAN, > 8 = CAN FD */
+    int padding;                              /* Fill byte or -1 for none */
+    int blockSize;                            /* BS sent in our flow control */
+    int stMin;                                /* STmin sent in our flow control */
+    int timeout;                              /* N_Bs / N_Cr in ms */
+    uint32_t savedRxTimeout;                  /* Handle Rx timeout restored on close */
+    Tcl_ThreadId threadId;                    /* Transport thread */
+
+    Tcl_Mutex mutex;                          /* Protects the fields below */
+    Tcl_Condition cond;                       /* Signalled on Tx completion and Rx PDU */
+    int stop;
+    int txRequest;                            /* PDU handed over by IsoTpSend */
+    int txDone;
+    int txStatus;                             /* ISOTP_* result of the last PDU */
+    NTCAN_RESULT txError;                     /* Driver error for ISOTP_ERR_DRIVER */
+    unsigned char *txData;
+    int txLen;
+    IsoTpPdu *rxFirst;                        /* Queue of reassembled PDUs */
+    IsoTpPdu *rxLast;
+    int rxQueued;
+
+    /* Transmit state, owned by the transport thread */
+    int txState;
+    int txPos;
+    int txSeq;
+    int txBlockSize;                          /* BS from the receiver, 0 = unlimited */
+    int txBlockLeft;                          /* CFs until next FC */
+    Tcl_WideInt txStMinUs;
+    Tcl_WideInt txDeadline;
+
+    /* Receive state, owned by the transport thread */
+    unsigned char *rxData;                    /* PDU being reassembled or NULL */
+    int rxLen;
+    int rxPos;
+    int rxSeq;
+    int rxBlockCount;
+    Tcl_WideInt rxDeadline;
+} IsoTpChannel;
+
+static int IsoTpFrameLen(int len) {
+    static const int sizes[] = { 8, 12, 16, 20, 24, 32, 48, 64 };
+
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+        if (len <= sizes[i]) {
+            return len <= 8 ? len : sizes[i];
+        }
+    }
+    return 64;
+}
+
+static Tcl_WideInt IsoTpStMinUs(int stMin) {
+    if (stMin <= 0x7F) {
+        return (Tcl_WideInt)stMin * 1000;
+    } else if (stMin >= 0xF1 && stMin <= 0xF9) {
+        return (Tcl_WideInt)(stMin - 0xF0) * 100;
+    }
+    return 127000;                            /* Reserved values: use the maximum */
+}
+
+static void IsoTpDelay(Tcl_WideInt us) {
+    Tcl_WideInt until;
+
+    if (us >= 1000) {
+        Tcl_Sleep((int)(us / 1000));
+        us %= 1000;
+    }
+    /* Sub-millisecond STmin cannot be slept portably, spin instead */
+    until = GetTimeUs() + us;
+    while (us > 0 && GetTimeUs() < until) {
+    }
+}
+
+/*
+ * Pads a frame to the next valid DLC. With padding enabled, frames are at
+ * least 8 bytes long; FD frames are never padded beyond the next DLC.
+ */
+static void IsoTpPrepare(IsoTpChannel *ch, CMSG_X *msg, int used) {
+    int len = IsoTpFrameLen(used);
+    int pad = ch->padding;
+
+    if (pad >= 0) {
+        len = len < 8 ? 8 : len;
+    } else if (used > 8) {
+        pad = ISOTP_PAD_DEFAULT;
+    }
+    if (len > used) {
+        memset(msg->data + used, pad, len - used);
+    }
+    msg->id = ch->txId;
+    msg->len = (ch->frameSize > 8 ? NTCAN_FD : 0) | NTCAN_DATASIZE_TO_DLC(len);
+}
+
+static NTCAN_RESULT IsoTpWrite(IsoTpChannel *ch, CMSG_X *frames, int32_t count) {
+    NTCAN_RESULT retvalue;
+    int32_t sent;
+
+    while (count > 0) {
+        sent = count;
+        retvalue = canWriteX(ch->handle, frames, &sent, NULL);
+        if (retvalue != NTCAN_SUCCESS) {
+            return retvalue;
+        }
+        frames += sent;
+        count -= sent;
+    }
+    return NTCAN_SUCCESS;
+}
+
+static void IsoTpSendFc(IsoTpChannel *ch, int status) {
+    CMSG_X msg;
+
+    msg.data[0] = (ISOTP_PCI_FC << 4) | status;
+    msg.data[1] = ch->blockSize;
+    msg.data[2] = ch->stMin;
+    IsoTpPrepare(ch, &msg, 3);
+    IsoTpWrite(ch, &msg, 1);
+}
+
+static void IsoTpFinishTx(IsoTpChannel *ch, int status, NTCAN_RESULT error) {
+    ch->txState = ISOTP_TX_IDLE;
+    Tcl_MutexLock(&ch->mutex);
+    ckfree((char *)ch->txData);
+    ch->txData = NULL;
+    ch->txStatus = status;
+    ch->txError = error;
+    ch->txDone = 1;
+    Tcl_ConditionNotify(&ch->cond);
+    Tcl_MutexUnlock(&ch->mutex);
+}
+
+static void IsoTpStartTx(IsoTpChannel *ch) {
+    CMSG_X msg;
+    NTCAN_RESULT retvalue;
+    int pci, n;
+
+    if (ch->txLen <= (ch->frameSize > 8 ? ch->frameSize - 2 : 7)) {
+        /*
+         * Single frame. The short PCI is only allowed in frames of at most
+         * 8 bytes, which IsoTpPrepare() keeps for 8 used bytes; longer
+         * frames need the escape PCI.
+         */
+        if (1 + ch->txLen <= 8) {
+            msg.data[0] = (ISOTP_PCI_SF << 4) | ch->txLen;
+            pci = 1;
+        } else {
+            msg.data[0] = ISOTP_PCI_SF << 4;
+            msg.data[1] = ch->txLen;
+            pci = 2;
+        }
+        memcpy(msg.data + pci, ch->txData, ch->txLen);
+        IsoTpPrepare(ch, &msg, pci + ch->txLen);
+        retvalue = IsoTpWrite(ch, &msg, 1);
+        IsoTpFinishTx(ch, retvalue == NTCAN_SUCCESS ? ISOTP_OK : ISOTP_ERR_DRIVER, retvalue);
+        return;
+    }
+
+    if (ch->txLen <= 4095) {
+        msg.data[0] = (ISOTP_PCI_FF << 4) | (ch->txLen >> 8);
+        msg.data[1] = ch->txLen & 0xFF;
+        pci = 2;
+    } else {
+        msg.data[0] = ISOTP_PCI_FF << 4;
+        msg.data[1] = 0;
+        msg.data[2] = (ch->txLen >> 24) & 0xFF;
+        msg.data[3] = (ch->txLen >> 16) & 0xFF;
+        msg.data[4] = (ch->txLen >> 8) & 0xFF;
+        msg.data[5] = ch->txLen & 0xFF;
+        pci = 6;
+    }
+    n = ch->frameSize - pci;
+    memcpy(msg.data + pci, ch->txData, n);
+    IsoTpPrepare(ch, &msg, ch->frameSize);
+    retvalue = IsoTpWrite(ch, &msg, 1);
+    if (retvalue != NTCAN_SUCCESS) {
+        IsoTpFinishTx(ch, ISOTP_ERR_DRIVER, retvalue);
+        return;
+    }
+    ch->txPos = n;
+    ch->txSeq = 1;
+    ch->txState = ISOTP_TX_WAIT_FC;
+    ch->txDeadline = GetTimeUs() + (Tcl_WideInt)ch->timeout * 1000;
+}
+
+static void IsoTpSendCf(IsoTpChannel *ch) {
+    CMSG_X frames[ISOTP_BATCH];
+    NTCAN_RESULT retvalue;
+    int count = 0, n;
+
+    /* Without separation time the whole block goes out in one driver call */
+    do {
+        CMSG_X *msg = &frames[count++];
+        n = ch->txLen - ch->txPos;
+        if (n > ch->frameSize - 1) {
+            n = ch->frameSize - 1;
+        }
+        msg->data[0] = (ISOTP_PCI_CF << 4) | (ch->txSeq & 0x0F);
+        memcpy(msg->data + 1, ch->txData + ch->txPos, n);
+        IsoTpPrepare(ch, msg, n + 1);
+        ch->txPos += n;
+        ch->txSeq++;
+        if (ch->txBlockSize > 0 && --ch->txBlockLeft == 0) {
+            break;
+        }
+    } while (ch->txStMinUs == 0 && count < ISOTP_BATCH && ch->txPos < ch->txLen);
+
+    retvalue = IsoTpWrite(ch, frames, count);
+    if (retvalue != NTCAN_SUCCESS) {
+        IsoTpFinishTx(ch, ISOTP_ERR_DRIVER, retvalue);
+    } else if (ch->txPos >= ch->txLen) {
+        IsoTpFinishTx(ch, ISOTP_OK, NTCAN_SUCCESS);
+    } else if (ch->txBlockSize > 0 && ch->txBlockLeft == 0) {
+        ch->txState = ISOTP_TX_WAIT_FC;
+        ch->txDeadline = GetTimeUs() + (Tcl_WideInt)ch->timeout * 1000;
+    } else if (ch->txStMinUs > 0) {
+        IsoTpDelay(ch->txStMinUs);
+    }
+}
+
+static void IsoTpAbortRx(IsoTpChannel *ch) {
+    if (ch->rxData != NULL) {
+        ckfree((char *)ch->rxData);
+        ch->rxData = NULL;
+    }
+}
+
+static void IsoTpDeliver(IsoTpChannel *ch, const unsigned char *data, int len) {
+    IsoTpPdu *pdu;
+
+    Tcl_MutexLock(&ch->mutex);
+    if (ch->rxQueued < ISOTP_MAX_QUEUED) {
+        pdu = (IsoTpPdu *)ckalloc(sizeof(IsoTpPdu) + len);
+        pdu->next = NULL;
+        pdu->len = len;
+        memcpy(pdu->data, data, len);
+        if (ch->rxLast != NULL) {
+            ch->rxLast->next = pdu;
+        } else {
+            ch->rxFirst = pdu;
+        }
+        ch->rxLast = pdu;
+        ch->rxQueued++;
+        Tcl_ConditionNotify(&ch->cond);
+    }
+    Tcl_MutexUnlock(&ch->mutex);
+}
+
+static void IsoTpRxFrame(IsoTpChannel *ch, CMSG_X *msg) {
+    int size = NTCAN_LEN_TO_DATASIZE(msg->len);
+    int len, pci, n, full;
+    uint32_t ffLen;
+
+    if (msg->id != ch->rxId || (msg->len & NTCAN_RTR) || size < 1) {
+        return;
+    }
+
+    switch (msg->data[0] >> 4) {
+    case ISOTP_PCI_SF:
+        /* A new SF or FF terminates a reception in progress */
+        IsoTpAbortRx(ch);
+        len = msg->data[0] & 0x0F;
+        pci = 1;
+        if (size > 8) {
+            /* Frames beyond 8 bytes must use the escape PCI */
+            if (len != 0) {
+                break;
+            }
+            len = msg->data[1];
+            pci = 2;
+        }
+        if (len > 0 && pci + len <= size) {
+            IsoTpDeliver(ch, msg->data + pci, len);
+        }
+        break;
+
+    case ISOTP_PCI_FF:
+        IsoTpAbortRx(ch);
+        if (size < 8) {
+            break;
+        }
+        ffLen = ((msg->data[0] & 0x0F) << 8) | msg->data[1];
+        pci = 2;
+        if (ffLen == 0) {
+            ffLen = ((uint32_t)msg->data[2] << 24) | ((uint32_t)msg->data[3] << 16) |
+                    ((uint32_t)msg->data[4] << 8) | msg->data[5];
+            pci = 6;
+        }
+        /* Refuse the PDU rather than drop it after reassembly */
+        Tcl_MutexLock(&ch->mutex);
+        full = ch->rxQueued >= ISOTP_MAX_QUEUED;
+        Tcl_MutexUnlock(&ch->mutex);
+        if (ffLen > ISOTP_MAX_PDU || full) {
+            IsoTpSendFc(ch, ISOTP_FC_OVFLW);
+            break;
+        }
+        len = (int)ffLen;
+        n = size - pci;
+        if (n > len) {
+            n = len;
+        }
+        ch->rxData = (unsigned char *)ckalloc(len);
+        ch->rxLen = len;
+        memcpy(ch->rxData, msg->data + pci, n);
+        ch->rxPos = n;
+        ch->rxSeq = 1;
+        ch->rxBlockCount = 0;
+        ch->rxDeadline = GetTimeUs() + (Tcl_WideInt)ch->timeout * 1000;
+        IsoTpSendFc(ch, ISOTP_FC_CTS);
+        break;
+
+    case ISOTP_PCI_CF:
+        if (ch->rxData == NULL) {
+            break;
+        }
+        if ((msg->data[0] & 0x0F) != (ch->rxSeq & 0x0F)) {
+            IsoTpAbortRx(ch);
+            break;
+        }
+        n = ch->rxLen - ch->rxPos;
+        if (n > size - 1) {
+            n = size - 1;
+        }
+        memcpy(ch->rxData + ch->rxPos, msg->data + 1, n);
+        ch->rxPos += n;
+        ch->rxSeq++;
+        if (ch->rxPos >= ch->rxLen) {
+            IsoTpDeliver(ch, ch->rxData, ch->rxLen);
+            IsoTpAbortRx(ch);
+            break;
+        }
+        ch->rxDeadline = GetTimeUs() + (Tcl_WideInt)ch->timeout * 1000;
+        if (ch->blockSize > 0 && ++ch->rxBlockCount == ch->blockSize) {
+            ch->rxBlockCount = 0;
+            IsoTpSendFc(ch, ISOTP_FC_CTS);
+        }
+        break;
+
+    case ISOTP_PCI_FC:
+        if (ch->txState != ISOTP_TX_WAIT_FC || size < 3) {
+            break;
+        }
+        switch (msg->data[0] & 0x0F) {
+        case ISOTP_FC_CTS:
+            ch->txBlockSize = msg->data[1];
+            ch->txBlockLeft = msg->data[1];
+            ch->txStMinUs = IsoTpStMinUs(msg->data[2]);
+            ch->txState = ISOTP_TX_CF;
+            break;
+        case ISOTP_FC_WAIT:
+            ch->txDeadline = GetTimeUs() + (Tcl_WideInt)ch->timeout * 1000;
+            break;
+        default:
+            IsoTpFinishTx(ch, ISOTP_ERR_OVERFLOW, NTCAN_SUCCESS);
+            break;
+        }
+        break;
+    }
+}
+
+static Tcl_ThreadCreateType IsoTpThread(ClientData cData) {
+    IsoTpChannel *ch = (IsoTpChannel *)cData;
+    CMSG_X frames[ISOTP_BATCH];
+    NTCAN_RESULT retvalue;
+    Tcl_WideInt now;
+    int32_t count;
+    int start;
+
+    PERF_WORKER("isotp", ch->handle);
+    for (;;) {
+        Tcl_MutexLock(&ch->mutex);
+        if (ch->stop) {
+            Tcl_MutexUnlock(&ch->mutex);
+            break;
+        }
+        start = ch->txState == ISOTP_TX_IDLE && ch->txRequest;
+        ch->txRequest = 0;
+        Tcl_MutexUnlock(&ch->mutex);
+
+        if (start) {
+            IsoTpStartTx(ch);
+        }
+
+        count = ISOTP_BATCH;
+        if (ch->txState == ISOTP_TX_CF) {
+            IsoTpSendCf(ch);
+            retvalue = canTakeX(ch->handle, frames, &count);
+        } else {
+            retvalue = canReadX(ch->handle, frames, &count, NULL);
+        }
+        if (retvalue == NTCAN_SUCCESS) {
+            for (int i = 0; i < count; i++) {
+                IsoTpRxFrame(ch, &frames[i]);
+            }
+        } else if (retvalue != NTCAN_RX_TIMEOUT && retvalue != NTCAN_OPERATION_ABORTED) {
+            Tcl_Sleep(ISOTP_POLL_MS);
+        }
+
+        now = GetTimeUs();
+        if (ch->txState == ISOTP_TX_WAIT_FC && now > ch->txDeadline) {
+            IsoTpFinishTx(ch, ISOTP_ERR_TIMEOUT, NTCAN_SUCCESS);
+        }
+        if (ch->rxData != NULL && now > ch->rxDeadline) {
+            IsoTpAbortRx(ch);
+        }
+    }
+
+    if (ch->txState != ISOTP_TX_IDLE) {
+        IsoTpFinishTx(ch, ISOTP_ERR_CLOSED, NTCAN_SUCCESS);
+    }
+    IsoTpAbortRx(ch);
+
+    PERF_WORKER_DONE();
+    TCL_THREAD_CREATE_RETURN;
+}
+
+static void StopIsoTp(IsoTpChannel *ch) {
+    IsoTpPdu *pdu;
+    int result;
+
+    Tcl_MutexLock(&ch->mutex);
+    ch->stop = 1;
+    Tcl_MutexUnlock(&ch->mutex);
+    canIoctl(ch->handle, NTCAN_IOCTL_ABORT_RX, NULL);
+    Tcl_JoinThread(ch->threadId, &result);
+
+    canIoctl(ch->handle, NTCAN_IOCTL_SET_RX_TIMEOUT, &ch->savedRxTimeout);
+    while ((pdu = ch->rxFirst) != NULL) {
+        ch->rxFirst = pdu->next;
+        ckfree((char *)pdu);
+    }
+    if (ch->txData != NULL) {
+        ckfree((char *)ch->txData);
+    }
+    Tcl_ConditionFinalize(&ch->cond);
+    Tcl_MutexFinalize(&ch->mutex);
+    ckfree((char *)ch);
+}
+
+static IsoTpChannel *GetIsoTp(Tcl_Interp *interp, Tcl_Obj *objHandle) {
+    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
+    HandleInfo *info;
+
+    if (Tcl_GetWideIntFromObj(interp, objHandle, &handle) != TCL_OK) {
+        return NULL;
+    }
+    info = GetHandleInfo(handle, 0);
+    if (info == NULL || info->isotp == NULL) {
+        Tcl_AppendResult(interp, "NTCAN no ISO-TP channel open on this handle", NULL);
+        return NULL;
+    }
+    return info->isotp;
+}
+
+int IsoTpOpen(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
+    int txId, rxId;                           /* CAN-IDs of transmitted / received frames */
+    int frameSize;                            /* 8 = classic CAN, 12..64 = CAN FD */
+    int padding;                              /* Fill byte or -1 for none */
+    int blockSize;                            /* BS sent in flow control */
+    int stMin;                                /* STmin sent in flow control */
+    int timeout;                              /* N_Bs / N_Cr in ms */
+    uint32_t rxTimeout;
+    NTCAN_RESULT retvalue;                    /* Return values of NTCAN API calls */
+    HandleInfo *info;
+    IsoTpChannel *ch;
+
+    if (objc != 9) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle txId rxId frameSize padding blockSize stMin timeout");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetWideIntFromObj(interp, objv[1], &handle) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[2], &txId) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[3], &rxId) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[4], &frameSize) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[5], &padding) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[6], &blockSize) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[7], &stMin) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[8], &timeout) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (frameSize < 8 || frameSize > 64 || IsoTpFrameLen(frameSize) != frameSize) {
+        Tcl_AppendResult(interp, "NTCAN ISO-TP frameSize must be 8, 12, 16, 20, 24, 32, 48 or 64", NULL);
+        return TCL_ERROR;
+    }
+    if (padding < -1 || padding > 255 || blockSize < 0 || blockSize > 255 ||
+        !(stMin >= 0 && (stMin <= 0x7F || (stMin >= 0xF1 && stMin <= 0xF9))) || timeout < 1) {
+        Tcl_AppendResult(interp, "NTCAN ISO-TP parameter out of range", NULL);
+        return TCL_ERROR;
+    }
+
+    info = GetHandleInfo(handle, 1);
+    if (info->isotp != NULL) {
+        Tcl_AppendResult(interp, "NTCAN ISO-TP channel already open on this handle", NULL);
+        return TCL_ERROR;
+    }
+    if (info->gateway != NULL || info->exchanges != NULL) {
+        Tcl_AppendResult(interp, "NTCAN receive path of handle already in use", NULL);
+        return TCL_ERROR;
+    }
+
+    /* The transport thread polls with a short Rx timeout to honour N_Cr/N_Bs */
+    retvalue = canIoctl((NTCAN_HANDLE)handle, NTCAN_IOCTL_GET_RX_TIMEOUT, &rxTimeout);
+    if (retvalue == NTCAN_SUCCESS) {
+        uint32_t pollTimeout = ISOTP_POLL_MS;
+        retvalue = canIoctl((NTCAN_HANDLE)handle, NTCAN_IOCTL_SET_RX_TIMEOUT, &pollTimeout);
+    }
+    if (retvalue != NTCAN_SUCCESS) {
+        FormatError(interp, "canIoctl", retvalue);
+        return TCL_ERROR;
+    }
+
+    ch = (IsoTpChannel *)ckalloc(sizeof(IsoTpChannel));
+    memset(ch, 0, sizeof(IsoTpChannel));
+    ch->handle = (NTCAN_HANDLE)handle;
+    ch->txId = txId;
+    ch->rxId = rxId;
+    ch->frameSize = frameSize;
+    ch->padding = padding;
+    ch->blockSize = blockSize;
+    ch->stMin = stMin;
+    ch->timeout = timeout;
+    ch->savedRxTimeout = rxTimeout;
+    ch->txState = ISOTP_TX_IDLE;
+
+    if (Tcl_CreateThread(&ch->threadId, IsoTpThread, ch,
+                         TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE) != TCL_OK) {
+        canIoctl((NTCAN_HANDLE)handle, NTCAN_IOCTL_SET_RX_TIMEOUT, &rxTimeout);
+        ckfree((char *)ch);
+        Tcl_AppendResult(interp, "NTCAN cannot create ISO-TP thread", NULL);
+        return TCL_ERROR;
+    }
+    info->isotp = ch;
+    return TCL_OK;
+}
+
+int IsoTpClose(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
+    HandleInfo *info;
+
+    if (objc != 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle");
+        return TCL_ERROR;
+    }
+    if (GetIsoTp(interp, objv[1]) == NULL) {
+        return TCL_ERROR;
+    }
+    Tcl_GetWideIntFromObj(interp, objv[1], &handle);
+
+    info = GetHandleInfo(handle, 0);
+    StopIsoTp(info->isotp);
+    info->isotp = NULL;
+    return TCL_OK;
+}
+
+int IsoTpSend(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    IsoTpChannel *ch;
+    int status;
+    NTCAN_RESULT error;
+
+    if (objc != 3) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle data");
+        return TCL_ERROR;
+    }
+    if ((ch = GetIsoTp(interp, objv[1])) == NULL) {
+        return TCL_ERROR;
+    }
+
+    int dataLen;
+    unsigned char *tclData = Tcl_GetByteArrayFromObj(objv[2], &dataLen);
+    if (dataLen < 1 || dataLen > ISOTP_MAX_PDU) {
+        Tcl_AppendResult(interp, "NTCAN IsoTpSend() data length out of range", NULL);
+        return TCL_ERROR;
+    }
+
+    Tcl_MutexLock(&ch->mutex);
+    if (ch->txData != NULL) {
+        Tcl_MutexUnlock(&ch->mutex);
+        Tcl_AppendResult(interp, "NTCAN IsoTpSend() transmission already in progress", NULL);
+        return TCL_ERROR;
+    }
+    ch->txData = (unsigned char *)ckalloc(dataLen);
+    memcpy(ch->txData, tclData, dataLen);
+    ch->txLen = dataLen;
+    ch->txDone = 0;
+    ch->txRequest = 1;
+    /* Wake the transport thread from its blocking canReadX() */
+    canIoctl(ch->handle, NTCAN_IOCTL_ABORT_RX, NULL);
+    while (!ch->txDone) {
+        Tcl_ConditionWait(&ch->cond, &ch->mutex, NULL);
+    }
+    status = ch->txStatus;
+    error = ch->txError;
+    Tcl_MutexUnlock(&ch->mutex);
+
+    switch (status) {
+    case ISOTP_OK:
+        return TCL_OK;
+    case ISOTP_ERR_TIMEOUT:
+        Tcl_AppendResult(interp, "NTCAN IsoTpSend() flow control timeout", NULL);
+        return TCL_ERROR;
+    case ISOTP_ERR_OVERFLOW:
+        Tcl_AppendResult(interp, "NTCAN IsoTpSend() receiver reported overflow", NULL);
+        return TCL_ERROR;
+    case ISOTP_ERR_DRIVER:
+        FormatError(interp, "canWriteX", error);
+        return TCL_ERROR;
+    default:
+        Tcl_AppendResult(interp, "NTCAN IsoTpSend() channel closed", NULL);
+        return TCL_ERROR;
+    }
+}
+
+int IsoTpReceive(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    IsoTpChannel *ch;
+    IsoTpPdu *pdu;
+    int timeout;                              /* Wait time in ms */
+    Tcl_WideInt deadline, remaining;
+    Tcl_Time wait;
+
+    if (objc != 3) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle timeout");
+        return TCL_ERROR;
+    }
+    if ((ch = GetIsoTp(interp, objv[1])) == NULL ||
+        Tcl_GetIntFromObj(interp, objv[2], &timeout) != TCL_OK) {
+        return TCL_ERROR;
+    }
+
+    deadline = GetTimeUs() + (Tcl_WideInt)timeout * 1000;
+    Tcl_MutexLock(&ch->mutex);
+    while (ch->rxFirst == NULL) {
+        remaining = deadline - GetTimeUs();
+        if (remaining <= 0) {
+            break;
+        }
+        wait.sec = (long)(remaining / 1000000);
+        wait.usec = (long)(remaining % 1000000);
+        Tcl_ConditionWait(&ch->cond, &ch->mutex, &wait);
+    }
+    pdu = ch->rxFirst;
+    if (pdu != NULL) {
+        ch->rxFirst = pdu->next;
+        if (ch->rxFirst == NULL) {
+            ch->rxLast = NULL;
+        }
+        ch->rxQueued--;
+    }
+    Tcl_MutexUnlock(&ch->mutex);
+
+    if (pdu == NULL) {
+        Tcl_AppendResult(interp, "NTCAN IsoTpReceive() returned timeout", NULL);
+        return TCL_ERROR;
+    }
+    Tcl_SetObjResult(interp, Tcl_NewByteArrayObj(pdu->data, pdu->len));
+    ckfree((char *)pdu);
+    return TCL_OK;
+}
+
+/*
+ * Request/response exchange: the response match is armed before the request
+ * is transmitted and evaluated in C on the receive path, so unrelated frames
+ * never reach Tcl. The latency is taken from driver timestamps when the
+ * driver provides them.
+ */
+
+#define EXCHANGE_BATCH 32                     /* Frames per canReadX() call */
+
+enum { EXCHANGE_OK, EXCHANGE_TIMEOUT, EXCHANGE_ERROR, EXCHANGE_CANCELLED };
+
+typedef struct Exchange {
+    struct Exchange *nextPtr;                 /* Pending exchanges of the handle */
+    NTCAN_HANDLE handle;                      /* CAN handle returned by canOpen() */
+    CMSG_X request;                           /* Frame to transmit */
+    int32_t rxId;                             /* Expected response ID ... */
+    int32_t rxMask;                           /* ... compared under this mask */
+    unsigned char match[64];                  /* Expected data bytes ... */
+    unsigned char matchMask[64];              /* ... compared under this mask */
+    int matchLen;                             /* Number of data bytes compared */
+    int timeout;                              /* Response timeout in ms */
+
+    int status;                               /* EXCHANGE_* result */
+    NTCAN_RESULT error;                       /* Driver error for EXCHANGE_ERROR ... */
+    char *errorCall;                          /* ... and the failing NTCAN call */
+    CMSG_X response;                          /* Matching frame */
+    Tcl_WideInt latency;                      /* Request to response in us */
+    Tcl_WideInt discarded;                    /* Frames that did not match */
+
+    Tcl_Interp *interp;                       /* Asynchronous mode only */
+    Tcl_Obj *command;
+    Tcl_ThreadId ownerId;
+    Tcl_ThreadId threadId;
+    unsigned long serial;
+    int cancel;
+} Exchange;
+
+typedef struct ExchangeEvent {
+    Tcl_Event header;
+    TCL_NTCAN_HANDLE handle;
+    Exchange *ex;
+    unsigned long serial;
+} ExchangeEvent;
+
+static unsigned long exchangeSerial = 0;
+TCL_DECLARE_MUTEX(exchangeMutex)
+
+static int ExchangeMatch(Exchange *ex, CMSG_X *msg) {
+    int size = NTCAN_LEN_TO_DATASIZE(msg->len);
+
+    if ((msg->id & ex->rxMask) != (ex->rxId & ex->rxMask)) {
+        return 0;
+    }
+    if (size < ex->matchLen) {
+        for (int i = size; i < ex->matchLen; i++) {
+            if (ex->matchMask[i] != 0) {
+                return 0;
+            }
+        }
+    }
+    for (int i = 0; i < ex->matchLen && i < size; i++) {
+        if ((msg->data[i] ^ ex->match[i]) & ex->matchMask[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int ExchangeCancelled(Exchange *ex) {
+    int cancel;
+
+    Tcl_MutexLock(&exchangeMutex);
+    cancel = ex->cancel;
+    Tcl_MutexUnlock(&exchangeMutex);
+    return cancel;
+}
+
+static void ExchangeRun(Exchange *ex) {
+    CMSG_X frames[EXCHANGE_BATCH];
+    NTCAN_RESULT retvalue;
+    NTCAN_TIMESTAMP freq = 0, txStamp = 0;
+    Tcl_WideInt start, deadline, remaining;
+    uint32_t savedRxTimeout, rxTimeout = 0, wait;
+    int32_t count;
+
+    /*
+     * Driver timestamps give the latency on the bus, not in the host. The
+     * stamp is taken before the write so a fast response is never older.
+     */
+    if (canIoctl(ex->handle, NTCAN_IOCTL_GET_TIMESTAMP_FREQ, &freq) != NTCAN_SUCCESS ||
+        canIoctl(ex->handle, NTCAN_IOCTL_GET_TIMESTAMP, &txStamp) != NTCAN_SUCCESS) {
+        freq = 0;
+    }
+    if ((retvalue = canIoctl(ex->handle, NTCAN_IOCTL_GET_RX_TIMEOUT, &savedRxTimeout)) != NTCAN_SUCCESS) {
+        ex->status = EXCHANGE_ERROR;
+        ex->error = retvalue;
+        ex->errorCall = (char *)"canIoctl";
+        return;
+    }
+
+    /* Without timestamps, frames already queued are told apart by draining them */
+    while (freq == 0) {
+        count = EXCHANGE_BATCH;
+        if (canTakeX(ex->handle, frames, &count) != NTCAN_SUCCESS || count == 0) {
+            break;
+        }
+        ex->discarded += count;
+    }
+
+    /* Latency is measured from before the write, host transmit time included */
+    start = GetTimeUs();
+    deadline = start + (Tcl_WideInt)ex->timeout * 1000;
+    count = 1;
+    retvalue = canWriteX(ex->handle, &ex->request, &count, NULL);
+    if (retvalue != NTCAN_SUCCESS) {
+        ex->status = EXCHANGE_ERROR;
+        ex->error = retvalue;
+        ex->errorCall = (char *)"canWriteX";
+        return;
+    }
+
+    ex->status = EXCHANGE_TIMEOUT;
+    while (ex->status == EXCHANGE_TIMEOUT) {
+        remaining = deadline - GetTimeUs();
+        if (remaining <= 0) {
+            break;
+        }
+        if (ExchangeCancelled(ex)) {
+            ex->status = EXCHANGE_CANCELLED;
+            break;
+        }
+
+        /* Bound the blocking read by the remaining response time */
+        wait = (uint32_t)((remaining + 999) / 1000);
+        if (wait != rxTimeout) {
+            rxTimeout = wait;
+            canIoctl(ex->handle, NTCAN_IOCTL_SET_RX_TIMEOUT, &rxTimeout);
+        }
+
+        count = EXCHANGE_BATCH;
+        retvalue = canReadX(ex->handle, frames, &count, NULL);
+        if (retvalue == NTCAN_RX_TIMEOUT || retvalue == NTCAN_OPERATION_ABORTED) {
+            continue;
+        } else if (retvalue != NTCAN_SUCCESS) {
+            ex->status = EXCHANGE_ERROR;
+            ex->error = retvalue;
+            ex->errorCall = (char *)"canReadX";
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            /* Frames received before the request can not be its response */
+            if (freq != 0 && frames[i].timestamp < txStamp) {
+                ex->discarded++;
+                continue;
+            }
+            if (!ExchangeMatch(ex, &frames[i])) {
+                ex->discarded++;
+                continue;
+            }
+            ex->response = frames[i];
+            if (freq != 0) {
+                ex->latency = (Tcl_WideInt)((frames[i].timestamp - txStamp) * 1000000 / freq);
+            } else {
+                ex->latency = GetTimeUs() - start;
+            }
+            ex->status = EXCHANGE_OK;
+            ex->discarded += count - i - 1;
+            break;
+        }
+    }
+
+    if (rxTimeout != 0) {
+        canIoctl(ex->handle, NTCAN_IOCTL_SET_RX_TIMEOUT, &savedRxTimeout);
+    }
+}
+
+static Tcl_Obj *ExchangeResultObj(Exchange *ex) {
+    Tcl_Obj *objResult = Tcl_NewListObj(0, NULL);
+
+    Tcl_ListObjAppendElement(NULL, objResult, Tcl_NewLongObj(ex->response.id));
+    Tcl_ListObjAppendElement(NULL, objResult, Tcl_NewIntObj(ex->response.len & 0xF0));
+    Tcl_ListObjAppendElement(NULL, objResult, Tcl_NewIntObj(NTCAN_LEN_TO_DATASIZE(ex->response.len)));
+    Tcl_ListObjAppendElement(NULL, objResult, Tcl_NewByteArrayObj(ex->response.data, NTCAN_LEN_TO_DATASIZE(ex->response.len)));
+    Tcl_ListObjAppendElement(NULL, objResult, Tcl_NewWideIntObj(ex->latency));
+    return objResult;
+}
+
+static void FreeExchange(Exchange *ex) {
+    if (ex->command != NULL) {
+        Tcl_DecrRefCount(ex->command);
+        Tcl_Release(ex->interp);
+    }
+    ckfree((char *)ex);
+}
+
+/* Unlinks ex from the pending exchanges of its handle, returns 0 if gone */
+static int UnlinkExchange(HandleInfo *info, Exchange *ex, unsigned long serial) {
+    Exchange **exPtr;
+
+    for (exPtr = &info->exchanges; *exPtr != NULL; exPtr = &(*exPtr)->nextPtr) {
+        if (*exPtr == ex && ex->serial == serial) {
+            *exPtr = ex->nextPtr;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int ExchangeEventProc(Tcl_Event *evPtr, int flags) {
+    ExchangeEvent *event = (ExchangeEvent *)evPtr;
+    HandleInfo *info = GetHandleInfo(event->handle, 0);
+    Exchange *ex = event->ex;
+    Tcl_Obj *args[3];
+    char errorTxt[STATUS_TXT_LEN];
+    char statusTxt[STATUS_TXT_LEN];
+    int result;
+
+    /* The exchange is gone if the handle was closed in the meantime */
+    if (info == NULL || !UnlinkExchange(info, ex, event->serial)) {
+        return 1;
+    }
+    Tcl_JoinThread(ex->threadId, &result);
+
+    args[0] = Tcl_NewWideIntObj(event->handle);
+    switch (ex->status) {
+    case EXCHANGE_OK:
+        args[1] = Tcl_NewStringObj("ok", -1);
+        args[2] = ExchangeResultObj(ex);
+        break;
+    case EXCHANGE_TIMEOUT:
+        args[1] = Tcl_NewStringObj("timeout", -1);
+        args[2] = Tcl_NewObj();
+        break;
+    default:
+        /* Not via FormatError, the interpreter result may be in use here */
+        canFormatError(ex->error, NTCAN_ERROR_FORMAT_LONG, errorTxt, sizeof(errorTxt));
+        snprintf(statusTxt, sizeof(statusTxt), "NTCAN %s() failed with error: %d / %s",
+                 ex->errorCall, ex->error, errorTxt);
+        args[1] = Tcl_NewStringObj("error", -1);
+        args[2] = Tcl_NewStringObj(statusTxt, -1);
+        break;
+    }
+    InvokeCallback(ex->interp, ex->command, 3, args);
+    FreeExchange(ex);
+    return 1;
+}
+
+static Tcl_ThreadCreateType ExchangeThread(ClientData cData) {
+    Exchange *ex = (Exchange *)cData;
+    ExchangeEvent *event;
+
+    PERF_WORKER("request", ex->handle);
+    ExchangeRun(ex);
+
+    event = (ExchangeEvent *)ckalloc(sizeof(ExchangeEvent));
+    event->header.proc = ExchangeEventProc;
+    event->handle = (TCL_NTCAN_HANDLE)ex->handle;
+    event->ex = ex;
+    event->serial = ex->serial;
+    Tcl_ThreadQueueEvent(ex->ownerId, (Tcl_Event *)event, TCL_QUEUE_TAIL);
+    Tcl_ThreadAlert(ex->ownerId);
+
+    PERF_WORKER_DONE();
+    TCL_THREAD_CREATE_RETURN;
+}
+
+static void CancelExchanges(HandleInfo *info) {
+    Exchange *ex;
+    int result;
+
+    while ((ex = info->exchanges) != NULL) {
+        info->exchanges = ex->nextPtr;
+        Tcl_MutexLock(&exchangeMutex);
+        ex->cancel = 1;
+        Tcl_MutexUnlock(&exchangeMutex);
+        canIoctl(ex->handle, NTCAN_IOCTL_ABORT_RX, NULL);
+        Tcl_JoinThread(ex->threadId, &result);
+        FreeExchange(ex);
+    }
+}
+
+int Request(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
+    int txId, mode, rxId, rxMask, timeout;
+    Exchange *ex;
+
+    if (objc != 10 && objc != 11) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle id mode data rxId rxMask match matchMask timeout ?command?");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetWideIntFromObj(interp, objv[1], &handle) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[2], &txId) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[3], &mode) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[5], &rxId) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[6], &rxMask) != TCL_OK ||
+        Tcl_GetIntFromObj(interp, objv[9], &timeout) != TCL_OK) {
+        return TCL_ERROR;
+    }
+
+    int dataLen, matchLen, maskLen;
+    unsigned char *tclData = Tcl_GetByteArrayFromObj(objv[4], &dataLen);
+    unsigned char *tclMatch = Tcl_GetByteArrayFromObj(objv[7], &matchLen);
+    unsigned char *tclMask = Tcl_GetByteArrayFromObj(objv[8], &maskLen);
+    if (dataLen > 64) {
+        Tcl_AppendResult(interp, "NTCAN Request() data length > 64", NULL);
+        return TCL_ERROR;
+    }
+    if (maskLen > 64 || matchLen < maskLen) {
+        Tcl_AppendResult(interp, "NTCAN Request() match shorter than matchMask or longer than 64", NULL);
+        return TCL_ERROR;
+    }
+
+    /* The exchange reads the receive FIFO and changes the Rx timeout of the handle */
+    HandleInfo *info = GetHandleInfo(handle, 0);
+    if (info != NULL && info->exchanges != NULL) {
+        Tcl_AppendResult(interp, "NTCAN request already pending on this handle", NULL);
+        return TCL_ERROR;
+    }
+    if (info != NULL && (info->isotp != NULL || info->gateway != NULL)) {
+        Tcl_AppendResult(interp, "NTCAN receive path of handle used by an ISO-TP channel or gateway", NULL);
+        return TCL_ERROR;
+    }
+
+    ex = (Exchange *)ckalloc(sizeof(Exchange));
+    memset(ex, 0, sizeof(Exchange));
+    ex->handle = (NTCAN_HANDLE)handle;
+    ex->request.id = txId;
+    ex->request.len = mode | NTCAN_DATASIZE_TO_DLC(dataLen);
+    memcpy(ex->request.data, tclData, dataLen);
+    ex->rxId = rxId;
+    ex->rxMask = rxMask;
+    memcpy(ex->match, tclMatch, maskLen);
+    memcpy(ex->matchMask, tclMask, maskLen);
+    ex->matchLen = maskLen;
+    ex->timeout = timeout;
+
+    if (objc == 10) {
+        ExchangeRun(ex);
+        switch (ex->status) {
+        case EXCHANGE_OK:
+            Tcl_SetObjResult(interp, ExchangeResultObj(ex));
+            ckfree((char *)ex);
+            return TCL_OK;
+        case EXCHANGE_TIMEOUT:
+            Tcl_AppendResult(interp, "NTCAN Request() returned timeout", NULL);
+            break;
+        default:
+            FormatError(interp, ex->errorCall, ex->error);
+            break;
+        }
+        ckfree((char *)ex);
+        return TCL_ERROR;
+    }
+
+    ex->interp = interp;
+    Tcl_Preserve(interp);
+    ex->command = objv[10];
+    Tcl_IncrRefCount(ex->command);
+    ex->ownerId = Tcl_GetCurrentThread();
+    ex->serial = ++exchangeSerial;
+
+    if (Tcl_CreateThread(&ex->threadId, ExchangeThread, ex,
+                         TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE) != TCL_OK) {
+        FreeExchange(ex);
+        Tcl_AppendResult(interp, "NTCAN cannot create request thread", NULL);
+        return TCL_ERROR;
+    }
+    info = GetHandleInfo(handle, 1);
+    ex->nextPtr = info->exchanges;
+    info->exchanges = ex;
+    return TCL_OK;
+}
+
+/*
+ * Gateway: a native thread per direction reads a source handle and forwards
+ * frames to a destination handle through a compiled routing table. Standard
+ * IDs are routed by a direct lookup table, extended IDs by first match.
+ */
+
+#define GATEWAY_MAX_ROUTES 1024
+#define GATEWAY_BATCH      64                 /* Frames per canReadX()/canSendX() call */
+#define GATEWAY_POLL_MS    5                  /* Rx timeout while the gateway runs */
+#define GATEWAY_STD_IDS    2048
+
+typedef struct GatewayRoute {
+    int32_t id;                               /* Expected ID ... */
+    int32_t idMask;                           /* ... compared under this mask */
+    int32_t toId;                             /* Replacement ID bits ... */
+    int32_t toMask;                           /* ... taken under this mask */
+    uint8_t allow;                            /* 1 = forward, 0 = drop */
+    uint8_t toFd;                             /* Forward classic frames as CAN FD */
+} GatewayRoute;
+
+typedef struct Gateway {
+    NTCAN_HANDLE src;                         /* Handle frames are read from */
+    NTCAN_HANDLE dst;                         /* Handle frames are sent to */
+    int count;                                /* Number of routes */
+    GatewayRoute *routes;                     /* Routes plus the default at [count] */
+    uint16_t stdRoute[GATEWAY_STD_IDS];       /* Route index per standard ID */
+    uint32_t savedRxTimeout;                  /* Rx timeout of src restored on stop */
+    uint64_t tsFreq;                          /* Timestamp frequency of src, 0 = none */
+    Tcl_ThreadId threadId;
+    Tcl_Mutex mutex;                          /* Protects the fields below */
+    int stop;
+    Tcl_WideInt received;                     /* Frames read from src */
+    Tcl_WideInt forwarded;                    /* Frames accepted by dst */
+    Tcl_WideInt denied;                       /* Frames dropped by the routes */
+    Tcl_WideInt dropped;                      /* Frames dst did not accept */
+    NTCAN_RESULT lastError;                   /* Last failing driver call */
+    LatencyHistogram latency;                 /* Reception to hand-over in us */
+} Gateway;
+
+static GatewayRoute *GatewayLookup(Gateway *gw, int32_t id) {
+    if ((uint32_t)id < GATEWAY_STD_IDS) {
+        return &gw->routes[gw->stdRoute[id]];
+    }
+    for (int i = 0; i < gw->count; i++) {
+        if (((id ^ gw->routes[i].id) & gw->routes[i].idMask) == 0) {
+            return &gw->routes[i];
+        }
+    }
+    return &gw->routes[gw->count];
+}
+
+static Tcl_ThreadCreateType GatewayThread(ClientData cData) {
+    Gateway *gw = (Gateway *)cData;
+    CMSG_X frames[GATEWAY_BATCH];
+    CMSG_X out[GATEWAY_BATCH];
+    NTCAN_RESULT retvalue;
+    uint64_t now;
+    Tcl_WideInt readTime;
+    int32_t count, sent;
+    int n, denied;
+
+    PERF_WORKER("gateway", gw->src);
+    for (;;) {
+        Tcl_MutexLock(&gw->mutex);
+        if (gw->stop) {
+            Tcl_MutexUnlock(&gw->mutex);
+            break;
+        }
+        Tcl_MutexUnlock(&gw->mutex);
+
+        count = GATEWAY_BATCH;
+        retvalue = canReadX(gw->src, frames, &count, NULL);
+        if (retvalue != NTCAN_SUCCESS) {
+            if (retvalue != NTCAN_RX_TIMEOUT && retvalue != NTCAN_OPERATION_ABORTED) {
+                Tcl_MutexLock(&gw->mutex);
+                gw->lastError = retvalue;
+                Tcl_MutexUnlock(&gw->mutex);
+                Tcl_Sleep(GATEWAY_POLL_MS);
+            }
+            continue;
+        }
+        readTime = GetTimeUs();
+
+        n = 0;
+        for (int i = 0; i < count; i++) {
+            GatewayRoute *route = GatewayLookup(gw, frames[i].id);
+
+            if (!route->allow) {
+                continue;
+            }
+            out[n] = frames[i];
+            out[n].id = (frames[i].id & ~route->toMask) | (route->toId & route->toMask);
+            if (route->toFd && !(out[n].len & (NTCAN_FD | NTCAN_RTR))) {
+                out[n].len |= NTCAN_FD;
+            }
+            n++;
+        }
+        denied = count - n;
+
+        sent = n;
+        retvalue = NTCAN_SUCCESS;
+        if (n > 0) {
+            retvalue = canSendX(gw->dst, out, &sent);
+            if (retvalue != NTCAN_SUCCESS && (sent < 0 || sent > n)) {
+                sent = 0;
+            }
+        }
+
+        /* Latency from the driver timestamp of reception, else from the read */
+        if (sent > 0 && (gw->tsFreq == 0 ||
+                         canIoctl(gw->src, NTCAN_IOCTL_GET_TIMESTAMP, &now) != NTCAN_SUCCESS)) {
+            now = 0;
+        }
+
+        Tcl_MutexLock(&gw->mutex);
+        gw->received += count;
+        gw->denied += denied;
+        gw->forwarded += sent;
+        gw->dropped += n - sent;
+        if (retvalue != NTCAN_SUCCESS) {
+            gw->lastError = retvalue;
+        }
+        if (sent > 0) {
+            if (now != 0) {
+                for (int i = 0; i < sent; i++) {
+                    LatencyRecord(&gw->latency, (Tcl_WideInt)((now - out[i].timestamp) * 1000000 / gw->tsFreq));
+                }
+            } else {
+                Tcl_WideInt us = GetTimeUs() - readTime;
+                for (int i = 0; i < sent; i++) {
+                    LatencyRecord(&gw->latency, us);
+                }
+            }
+        }
+        Tcl_MutexUnlock(&gw->mutex);
+    }
+
+    PERF_WORKER_DONE();
+    TCL_THREAD_CREATE_RETURN;
+}
+
+static void StopGateway(Gateway *gw) {
+    int result;
+
+    Tcl_MutexLock(&gw->mutex);
+    gw->stop = 1;
+    Tcl_MutexUnlock(&gw->mutex);
+    canIoctl(gw->src, NTCAN_IOCTL_ABORT_RX, NULL);
+    Tcl_JoinThread(gw->threadId, &result);
+
+    canIoctl(gw->src, NTCAN_IOCTL_SET_RX_TIMEOUT, &gw->savedRxTimeout);
+    Tcl_MutexFinalize(&gw->mutex);
+    ckfree((char *)gw->routes);
+    ckfree((char *)gw);
+}
+
+/* Clears info->gateway under handleMutex, which StopGatewaysTo() walks */
+static Gateway *DetachGateway(HandleInfo *info) {
+    Gateway *gw;
+
+    Tcl_MutexLock(&handleMutex);
+    gw = info->gateway;
+    info->gateway = NULL;
+    Tcl_MutexUnlock(&handleMutex);
+    return gw;
+}
+
+/* Stops every gateway sending to dst, which is about to be closed */
+static void StopGatewaysTo(TCL_NTCAN_HANDLE dst) {
+    Tcl_HashEntry *entry;
+    Tcl_HashSearch search;
+    Gateway *gw;
+
+    do {
+        gw = NULL;
+        Tcl_MutexLock(&handleMutex);
+        for (entry = Tcl_FirstHashEntry(&handleTable, &search); entry != NULL && gw == NULL;
+             entry = Tcl_NextHashEntry(&search)) {
+            HandleInfo *info = (HandleInfo *)Tcl_GetHashValue(entry);
+
+            if (info->gateway != NULL && info->gateway->dst == (NTCAN_HANDLE)dst) {
+                gw = info->gateway;
+                info->gateway = NULL;
+            }
+        }
+        Tcl_MutexUnlock(&handleMutex);
+        if (gw != NULL) {
+            StopGateway(gw);
+        }
+    } while (gw != NULL);
+}
+
+static int GatewayCompileRoute(Tcl_Interp *interp, Tcl_Obj *objRoute, GatewayRoute *route) {
+    static const char *actions[] = { "deny", "allow", NULL };
+    static const char *options[] = { "id", "idmask", "toid", "tomask", "fd", NULL };
+    enum { OPT_ID, OPT_IDMASK, OPT_TOID, OPT_TOMASK, OPT_FD };
+    Tcl_Obj **elem;
+    int elemc, action, option, value;
+    int haveId = 0, haveIdMask = 0, haveToId = 0, haveToMask = 0;
+
+    if (Tcl_ListObjGetElements(interp, objRoute, &elemc, &elem) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (elemc < 1 || !(elemc & 1)) {
+        Tcl_AppendResult(interp, "NTCAN gateway route must be \"allow|deny ?option value ...?\"", NULL);
+        return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, elem[0], actions, "action", 0, &action) != TCL_OK) {
+        return TCL_ERROR;
+    }
+
+    memset(route, 0, sizeof(GatewayRoute));
+    route->allow = action;
+    for (int i = 1; i < elemc; i += 2) {
+        if (Tcl_GetIndexFromObj(interp, elem[i], options, "option", 0, &option) != TCL_OK ||
+            Tcl_GetIntFromObj(interp, elem[i + 1], &value) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        switch (option) {
+        case OPT_ID:
+            route->id = value;
+            haveId = 1;
+            break;
+        case OPT_IDMASK:
+            route->idMask = value;
+            haveIdMask = 1;
+            break;
+        case OPT_TOID:
+            route->toId = value;
+            haveToId = 1;
+            break;
+        case OPT_TOMASK:
+            route->toMask = value;
+            haveToMask = 1;
+            break;
+        case OPT_FD:
+            route->toFd = value != 0;
+            break;
+        }
+    }
+    if (!haveIdMask) {
+        /* An ID alone selects exactly that ID, no ID selects any */
+        route->idMask = haveId ? -1 : 0;
+    }
+    route->id &= route->idMask;
+    if (haveToId && !haveToMask) {
+        /* A target ID alone replaces the identifier, the frame format is kept */
+        route->toMask = NTCAN_20B_BASE - 1;
+    }
+    return TCL_OK;
+}
+
+int GatewayStart(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    static const char *actions[] = { "deny", "allow", NULL };
+    TCL_NTCAN_HANDLE src, dst;                /* CAN handles returned by canOpen() */
+    Tcl_Obj **objRoutes;
+    int routeCount, defaultAllow;
+    uint32_t rxTimeout;
+    NTCAN_RESULT retvalue;                    /* Return values of NTCAN API calls */
+    HandleInfo *info;
+    Gateway *gw;
+
+    if (objc != 5) {
+        Tcl_WrongNumArgs(interp, 1, objv, "src dst default routes");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetWideIntFromObj(interp, objv[1], &src) != TCL_OK ||
+        Tcl_GetWideIntFromObj(interp, objv[2], &dst) != TCL_OK ||
+        Tcl_GetIndexFromObj(interp, objv[3], actions, "action", 0, &defaultAllow) != TCL_OK ||
+        Tcl_ListObjGetElements(interp, objv[4], &routeCount, &objRoutes) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (src == dst) {
+        Tcl_AppendResult(interp, "NTCAN gateway source and destination must differ", NULL);
+        return TCL_ERROR;
+    }
+    if (routeCount > GATEWAY_MAX_ROUTES) {
+        Tcl_AppendResult(interp, "NTCAN too many gateway routes", NULL);
+        return TCL_ERROR;
+    }
+
+    gw = (Gateway *)ckalloc(sizeof(Gateway));
+    memset(gw, 0, sizeof(Gateway));
+    gw->src = (NTCAN_HANDLE)src;
+    gw->dst = (NTCAN_HANDLE)dst;
+    gw->count = routeCount;
+    gw->routes = (GatewayRoute *)ckalloc((routeCount + 1) * sizeof(GatewayRoute));
+    for (int i = 0; i < routeCount; i++) {
+        if (GatewayCompileRoute(interp, objRoutes[i], &gw->routes[i]) != TCL_OK) {
+            ckfree((char *)gw->routes);
+            ckfree((char *)gw);
+            return TCL_ERROR;
+        }
+    }
+    memset(&gw->routes[routeCount], 0, sizeof(GatewayRoute));
+    gw->routes[routeCount].allow = defaultAllow;
+
+    /* Resolve the first matching route of every standard ID once */
+    for (int id = 0; id < GATEWAY_STD_IDS; id++) {
+        int i;
+        for (i = 0; i < routeCount; i++) {
+            if (((id ^ gw->routes[i].id) & gw->routes[i].idMask) == 0) {
+                break;
+            }
+        }
+        gw->stdRoute[id] = i;
+    }
+
+    info = GetHandleInfo(src, 1);
+    if (info->gateway != NULL || info->isotp != NULL || info->exchanges != NULL) {
+        ckfree((char *)gw->routes);
+        ckfree((char *)gw);
+        Tcl_AppendResult(interp, "NTCAN receive path of source handle already in use", NULL);
+        return TCL_ERROR;
+    }
+
+    if (canIoctl(gw->src, NTCAN_IOCTL_GET_TIMESTAMP_FREQ, &gw->tsFreq) != NTCAN_SUCCESS) {
+        gw->tsFreq = 0;
+    }
+    retvalue = canIoctl(gw->src, NTCAN_IOCTL_GET_RX_TIMEOUT, &rxTimeout);
+    if (retvalue == NTCAN_SUCCESS) {
+        uint32_t pollTimeout = GATEWAY_POLL_MS;
+        retvalue = canIoctl(gw->src, NTCAN_IOCTL_SET_RX_TIMEOUT, &pollTimeout);
+    }
+    if (retvalue != NTCAN_SUCCESS) {
+        ckfree((char *)gw->routes);
+        ckfree((char *)gw);
+        FormatError(interp, "canIoctl", retvalue);
+        return TCL_ERROR;
+    }
+    gw->savedRxTimeout = rxTimeout;
+
+    if (Tcl_CreateThread(&gw->threadId, GatewayThread, gw,
+                         TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE) != TCL_OK) {
+        canIoctl(gw->src, NTCAN_IOCTL_SET_RX_TIMEOUT, &rxTimeout);
+        ckfree((char *)gw->routes);
+        ckfree((char *)gw);
+        Tcl_AppendResult(interp, "NTCAN cannot create gateway thread", NULL);
+        return TCL_ERROR;
+    }
+    Tcl_MutexLock(&handleMutex);
+    info->gateway = gw;
+    Tcl_MutexUnlock(&handleMutex);
+    return TCL_OK;
+}
+
+int GatewayStop(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    TCL_NTCAN_HANDLE src;                     /* CAN handle returned by canOpen() */
+    HandleInfo *info;
+    Gateway *gw = NULL;
+
+    if (objc != 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "src");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetWideIntFromObj(interp, objv[1], &src) != TCL_OK) {
+        return TCL_ERROR;
+    }
+
+    info = GetHandleInfo(src, 0);
+    if (info != NULL) {
+        gw = DetachGateway(info);
+    }
+    if (gw == NULL) {
+        Tcl_AppendResult(interp, "NTCAN no gateway running from this handle", NULL);
+        return TCL_ERROR;
+    }
+    StopGateway(gw);
+    return TCL_OK;
+}
+
+int GatewayInfo(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    TCL_NTCAN_HANDLE src;                     /* CAN handle returned by canOpen() */
+    HandleInfo *info;
+    Gateway *gw;
+
+    if (objc != 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "src");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetWideIntFromObj(interp, objv[1], &src) != TCL_OK) {
+        return TCL_ERROR;
+    }
+
+    info = GetHandleInfo(src, 0);
+    if (info == NULL || info->gateway == NULL) {
+        Tcl_AppendResult(interp, "NTCAN no gateway running from this handle", NULL);
+        return TCL_ERROR;
+    }
+    gw = info->gateway;
+
+    Tcl_Obj *objResult = Tcl_GetObjResult(interp);
+    Tcl_MutexLock(&gw->mutex);
+    Tcl_ListObjAppendElement(interp, objResult, Tcl_NewWideIntObj(gw->received));
+    Tcl_ListObjAppendElement(interp, objResult, Tcl_NewWideIntObj(gw->forwarded));
+    Tcl_ListObjAppendElement(interp, objResult, Tcl_NewWideIntObj(gw->denied));
+    Tcl_ListObjAppendElement(interp, objResult, Tcl_NewWideIntObj(gw->dropped));
+    Tcl_ListObjAppendElement(interp, objResult, Tcl_NewIntObj(gw->lastError));
+    Tcl_ListObjAppendElement(interp, objResult, LatencyObj(&gw->latency));
+    Tcl_MutexUnlock(&gw->mutex);
+    return TCL_OK;
+}
+
+/*
+ * Instrumentation snapshot and reset. Probes are reported per handle and
+ * context and only once they have been hit; durations are in ns.
+ */
+
+#ifdef NTCAN_PERF
+static Tcl_Obj *PerfProbesObj(PerfProbe *probes) {
+    Tcl_Obj *objProbes = Tcl_NewListObj(0, NULL);
+
+    for (int i = 0; i < PERF_CALLS; i++) {
+        PerfProbe *p = &probes[i];
+        Tcl_Obj *objProbe, *objBuckets;
+
+        if (p->calls == 0) {
+            continue;
+        }
+        objBuckets = Tcl_NewListObj(0, NULL);
+        for (int b = 0; b < LATENCY_BUCKETS; b++) {
+            if (p->hist.counts[b] != 0) {
+                Tcl_ListObjAppendElement(NULL, objBuckets, Tcl_NewWideIntObj(LatencyBucketUpper(b)));
+                Tcl_ListObjAppendElement(NULL, objBuckets, Tcl_NewWideIntObj(p->hist.counts[b]));
+            }
+        }
+        objProbe = Tcl_NewListObj(0, NULL);
+        Tcl_ListObjAppendElement(NULL, objProbe, Tcl_NewWideIntObj(p->calls));
+        Tcl_ListObjAppendElement(NULL, objProbe, Tcl_NewWideIntObj(p->errors));
+        Tcl_ListObjAppendElement(NULL, objProbe, Tcl_NewWideIntObj(p->total));
+        Tcl_ListObjAppendElement(NULL, objProbe, LatencyObj(&p->hist));
+        Tcl_ListObjAppendElement(NULL, objProbe, objBuckets);
+        Tcl_ListObjAppendElement(NULL, objProbes, Tcl_NewStringObj(perfCallNames[i], -1));
+        Tcl_ListObjAppendElement(NULL, objProbes, objProbe);
+    }
+    return objProbes;
+}
+
+static Tcl_Obj *PerfStatsObj(PerfStats *stats) {
+    Tcl_Obj *objStats = Tcl_NewListObj(0, NULL);
+
+    for (int i = 0; i < PERF_CONTEXTS; i++) {
+        if (stats->probes[i] != NULL) {
+            Tcl_ListObjAppendElement(NULL, objStats, Tcl_NewStringObj(perfContextNames[i], -1));
+            Tcl_ListObjAppendElement(NULL, objStats, PerfProbesObj(stats->probes[i]));
+        }
+    }
+    return objStats;
+}
+#endif
+
+int Perf(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    static const char *options[] = { "snapshot", "reset", NULL };
+    enum { PERF_SNAPSHOT, PERF_RESET };
+    TCL_NTCAN_HANDLE handle = 0;              /* CAN handle returned by canOpen() */
+    int option;
+
+    if (objc != 2 && objc != 3) {
+        Tcl_WrongNumArgs(interp, 1, objv, "option ?handle?");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], options, "option", 0, &option) != TCL_OK ||
+        (objc == 3 && Tcl_GetWideIntFromObj(interp, objv[2], &handle) != TCL_OK)) {
+        return TCL_ERROR;
+    }
+
+#ifdef NTCAN_PERF
+    Tcl_Obj *objResult = Tcl_NewListObj(0, NULL);
+    Tcl_HashEntry *entry;
+    Tcl_HashSearch search;
+
+    Tcl_MutexLock(&handleMutex);
+    for (entry = Tcl_FirstHashEntry(&handleTable, &search); entry != NULL; entry = Tcl_NextHashEntry(&search)) {
+        HandleInfo *info = (HandleInfo *)Tcl_GetHashValue(entry);
+
+        if (objc == 3 && info->handle != handle) {
+            continue;
+        }
+        Tcl_MutexLock(&info->perf->mutex);
+        if (option == PERF_RESET) {
+            for (int i = 0; i < PERF_CONTEXTS; i++) {
+                if (info->perf->probes[i] != NULL) {
+                    ckfree((char *)info->perf->probes[i]);
+                    info->perf->probes[i] = NULL;
+                }
+            }
+        } else if (objc == 3) {
+            Tcl_DecrRefCount(objResult);
+            objResult = PerfStatsObj(info->perf);
+        } else {
+            Tcl_ListObjAppendElement(NULL, objResult, Tcl_NewWideIntObj(info->handle));
+            Tcl_ListObjAppendElement(NULL, objResult, PerfStatsObj(info->perf));
+        }
+        Tcl_MutexUnlock(&info->perf->mutex);
+    }
+    Tcl_MutexUnlock(&handleMutex);
+
+    Tcl_SetObjResult(interp, objResult);
+    return TCL_OK;
+#else
+    Tcl_AppendResult(interp, "NTCAN built without instrumentation, configure with --enable-perf", NULL);
+    return TCL_ERROR;
+#endif
+}
+
+int Status(ClientData cData, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[]) {
+    TCL_NTCAN_HANDLE handle;                  /* CAN handle returned by canOpen() */
+    NTCAN_RESULT retvalue;                    /* Return values of NTCAN API calls */
+    CAN_IF_STATUS cstat;
+    char statusTxt[STATUS_TXT_LEN];
+
+    if (objc != 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "handle");
+        return TCL_ERROR;
+    }
+    Tcl_GetWideIntFromObj(interp, objv[1], &handle);
+
+    retvalue = canStatus((NTCAN_HANDLE)handle, &cstat);
+
+    if (retvalue != NTCAN_SUCCESS) {
+        FormatError(interp, "canStatus", retvalue);
+        return TCL_ERROR;
+    } else {
+        snprintf(statusTxt, sizeof(statusTxt), "ID=%s\n"
+                 "Dll=%1X.%1X.%02X\n"
+                 "Drv=%1X.%1X.%02X\n"
+                 "FW=%1X.%1X.%02X\n"
+                 "HW=%1X.%1X.%02X\n"
+                 "Status=%08x\n"
+                 "Features=%04x",
+                 cstat.boardid,
+                 cstat.dll     >>12, (cstat.dll     >>8) & 0xf, cstat.dll      & 0xff,
+                 cstat.driver  >>12, (cstat.driver  >>8) & 0xf, cstat.driver   & 0xff,
+                 cstat.firmware>>12, (cstat.firmware>>8) & 0xf, cstat.firmware & 0xff,
+                 cstat.hardware>>12, (cstat.hardware>>8) & 0xf, cstat.hardware & 0xff,
+                 (unsigned long)cstat.boardstatus,
+                 cstat.features);
+        Tcl_AppendResult(interp, &statusTxt, NULL);
+        return TCL_OK;
+    }
+}
+
+int Ntcan_Init(Tcl_Interp *interp) {
+    /* initialize Tcl stubs */
+    if (Tcl_InitStubs(interp, "8.6", 0) == NULL)
+        return TCL_ERROR;
+
+    // create namespace
+    if (Tcl_CreateNamespace(interp, NS_PREFIX, NULL, NULL) == NULL)
+        return TCL_ERROR;
+
+    // stop native worker threads on exit
+    Tcl_MutexLock(&handleMutex);
+    if (!handleTableInit) {
+        Tcl_InitHashTable(&handleTable, TCL_ONE_WORD_KEYS);
+        handleTableInit = 1;
+        Tcl_CreateExitHandler(HandleExitHandler, NULL);
+    }
+    Tcl_MutexUnlock(&handleMutex);
+
+    // initialize operation
+    Tcl_CreateObjCommand(interp, NS_PREFIX "Scan",               (Tcl_ObjCmdProc *)Scan, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "Open",               (Tcl_ObjCmdProc *)Open, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "Close",              (Tcl_ObjCmdProc *)Close, 0, 0);
     Tcl_CreateObjCommand(interp, NS_PREFIX "SetBaudrate",        (Tcl_ObjCmdProc *)SetBaudrate, 0, 0);
     Tcl_CreateObjCommand(interp, NS_PREFIX "GetBaudrate",        (Tcl_ObjCmdProc *)GetBaudrate, 0, 0);
     Tcl_CreateObjCommand(interp, NS_PREFIX "SetBaudrateX",       (Tcl_ObjCmdProc *)SetBaudrateX, 0, 0);
@@ -795,6 +4050,9 @@ int Ntcan_Init(Tcl_Interp *interp) {
     Tcl_CreateObjCommand(interp, NS_PREFIX "IdRegionAdd",        (Tcl_ObjCmdProc *)IdRegionAdd, 0, 0);
     Tcl_CreateObjCommand(interp, NS_PREFIX "IdDelete",           (Tcl_ObjCmdProc *)IdDelete, 0, 0);
     Tcl_CreateObjCommand(interp, NS_PREFIX "IdRegionDelete",     (Tcl_ObjCmdProc *)IdRegionDelete, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "FilterSet",          (Tcl_ObjCmdProc *)FilterSet, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "FilterClear",        (Tcl_ObjCmdProc *)FilterClear, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "FilterStats",        (Tcl_ObjCmdProc *)FilterStats, 0, 0);
     Tcl_CreateObjCommand(interp, NS_PREFIX "FlushRxFifo",        (Tcl_ObjCmdProc *)FlushRxFifo, 0, 0);
     Tcl_CreateObjCommand(interp, NS_PREFIX "GetRxMsgCount",      (Tcl_ObjCmdProc *)GetRxMsgCount, 0, 0);
     Tcl_CreateObjCommand(interp, NS_PREFIX "GetTxMsgCount",      (Tcl_ObjCmdProc *)GetTxMsgCount, 0, 0);
@@ -806,11 +4064,35 @@ int Ntcan_Init(Tcl_Interp *interp) {
     Tcl_CreateObjCommand(interp, NS_PREFIX "AbortTx",            (Tcl_ObjCmdProc *)AbortTx, 0, 0);
     Tcl_CreateObjCommand(interp, NS_PREFIX "GetBusStatistic",    (Tcl_ObjCmdProc *)GetBusStatistic, 0, 0);
     Tcl_CreateObjCommand(interp, NS_PREFIX "GetCtrlStatus",      (Tcl_ObjCmdProc *)GetCtrlStatus, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "MonitorStart",       (Tcl_ObjCmdProc *)MonitorStart, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "MonitorStop",        (Tcl_ObjCmdProc *)MonitorStop, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "MonitorRead",        (Tcl_ObjCmdProc *)MonitorRead, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "MonitorInfo",        (Tcl_ObjCmdProc *)MonitorInfo, 0, 0);
     Tcl_CreateObjCommand(interp, NS_PREFIX "Read",               (Tcl_ObjCmdProc *)Read, 0, 0);
     Tcl_CreateObjCommand(interp, NS_PREFIX "Write",              (Tcl_ObjCmdProc *)Write, 0, 0);
     Tcl_CreateObjCommand(interp, NS_PREFIX "ReadX",              (Tcl_ObjCmdProc *)ReadX, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "ReadBulk",           (Tcl_ObjCmdProc *)ReadBulk, 0, 0);
     Tcl_CreateObjCommand(interp, NS_PREFIX "WriteX",             (Tcl_ObjCmdProc *)WriteX, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "TxQueueStart",       (Tcl_ObjCmdProc *)TxQueueStart, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "TxQueueStop",        (Tcl_ObjCmdProc *)TxQueueStop, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "TxQueueSend",        (Tcl_ObjCmdProc *)TxQueueSend, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "TxQueueInfo",        (Tcl_ObjCmdProc *)TxQueueInfo, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "IsoTpOpen",          (Tcl_ObjCmdProc *)IsoTpOpen, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "IsoTpClose",         (Tcl_ObjCmdProc *)IsoTpClose, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "IsoTpSend",          (Tcl_ObjCmdProc *)IsoTpSend, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "IsoTpReceive",       (Tcl_ObjCmdProc *)IsoTpReceive, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "Request",            (Tcl_ObjCmdProc *)Request, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "GatewayStart",       (Tcl_ObjCmdProc *)GatewayStart, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "GatewayStop",        (Tcl_ObjCmdProc *)GatewayStop, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "GatewayInfo",        (Tcl_ObjCmdProc *)GatewayInfo, 0, 0);
     Tcl_CreateObjCommand(interp, NS_PREFIX "Status",             (Tcl_ObjCmdProc *)Status, 0, 0);
+    Tcl_CreateObjCommand(interp, NS_PREFIX "Perf",               (Tcl_ObjCmdProc *)Perf, 0, 0);
+
+#ifdef NTCAN_PERF
+    // key driver timings by command
+    if (PerfWrapCommands(interp) != TCL_OK)
+        return TCL_ERROR;
+#endif
 
     // provide package information
     if (Tcl_PkgProvide(interp, PACKAGE_NAME, PACKAGE_VERSION) != TCL_OK)
@@ -820,7 +4102,24 @@ int Ntcan_Init(Tcl_Interp *interp) {
 }
 
 int Ntcan_Unload(Tcl_Interp *interp, int flags) {
+    Tcl_Namespace *ns;
+
     // destroy operation.
+    ns = Tcl_FindNamespace(interp, "::" NS_PREFIX, NULL, 0);
+    if (ns != NULL)
+        Tcl_DeleteNamespace(ns);
+
+    // worker threads must not outlive the code they run
+    if (flags & TCL_UNLOAD_DETACH_FROM_PROCESS) {
+        HandleExitHandler(NULL);
+        Tcl_MutexLock(&handleMutex);
+        if (handleTableInit) {
+            Tcl_DeleteHashTable(&handleTable);
+            handleTableInit = 0;
+            Tcl_DeleteExitHandler(HandleExitHandler, NULL);
+        }
+        Tcl_MutexUnlock(&handleMutex);
+    }
     return TCL_OK;
 }
 